@@ -11,8 +11,11 @@ pycstlemma = Extension('cLemmatiser',
                     
                     'src/cstlemma/src/applyrules.cpp',
                     'src/cstlemma/src/argopt.cpp',
+                    'src/cstlemma/src/arena.cpp',
                     'src/cstlemma/src/basefrm.cpp',
                     'src/cstlemma/src/basefrmpntr.cpp',
+                    'src/cstlemma/src/bloomfilter.cpp',
+                    'src/cstlemma/src/bundle.cpp',
                     'src/cstlemma/src/caseconv.cpp',
                     'src/cstlemma/src/dictionary.cpp',
                     'src/cstlemma/src/field.cpp',
@@ -33,6 +36,7 @@ pycstlemma = Extension('cLemmatiser',
                     'src/cstlemma/src/readlemm.cpp',
                     'src/cstlemma/src/tags.cpp',
                     'src/cstlemma/src/text.cpp',
+                    'src/cstlemma/src/warmcache.cpp',
                     'src/cstlemma/src/word.cpp',
                     'src/cstlemma/src/wordReader.cpp',
                     'src/cstlemma/src/XMLtext.cpp',
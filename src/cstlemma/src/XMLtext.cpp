@@ -632,21 +632,15 @@ void XMLtext::DoYourWork(FILE *fpi, optionStruct &Option)
 
                     LOG1LINE("allocating array of pointers to words");
                 }
-                tunsorted = new const Word *[total];
                 Token = new token[total + 1]; // 1 extra for the epilogue after the last token
                 if (Option.nice)
                     LOG1LINE("allocating array of line offsets");
-                Lines = new unsigned long int[lineno + 1];
-                unsigned long int L = lineno + 1;
-                do
-                {
-                    --L;
-                    Lines[L] = 0;
-                } while (L != 0);
+                unsigned long int counted = total;
+                total = 0; // nothing to keep when reserve grows the arrays
+                reserve(counted, lineno + 1);
                 if (Option.nice)
                     LOG1LINE("...allocated array");
 
-                total = 0;
                 if (Option.nice)
                     LOG1LINE("reading words");
                 lineno = 0;
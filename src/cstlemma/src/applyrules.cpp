@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "flex.h"
 #include "utf8func.h"
 #include "caseconv.h"
+#include "bundle.h"
 //#include "option.h"
 #include <stdio.h>
 #include <string.h>
@@ -103,9 +104,18 @@ class rules
             {
             this->TagName = new char[strlen(TagName) + 1];
             strcpy(this->TagName, TagName);
-            char * filename = new char[strlen(TagName) + strlen(flexFileName) + 2];
-            sprintf(filename, "%s.%s", flexFileName, TagName);
-            FILE * f = fopen(filename, "rb");
+            char * filename = new char[strlen(TagName) + strlen(flexFileName) + sizeof(BS_FLEXRULES) + 1];
+            FILE * f;
+            if (bundle::isOpen())
+                {
+                sprintf(filename, "%s.%s", BS_FLEXRULES, TagName);
+                f = bundle::stream(filename);
+                }
+            else
+                {
+                sprintf(filename, "%s.%s", flexFileName, TagName);
+                f = fopen(filename, "rb");
+                }
             if (f)
                 {
                 buf = readRules(f, End);
@@ -1086,6 +1096,9 @@ static LemmaRule * newStyleLemmatizeV3
         }
     else
         candidate.ruleHasPrefix = parentcandidate ? parentcandidate->ruleHasPrefix : false;
+#if PRINTRULE
+    candidate.rule = 0;
+#endif
     candidate.L = rewrite(cword, cwordend, p
 #if PRINTRULE
                          , beginOfWord, candidate.rule
@@ -1119,6 +1132,9 @@ static LemmaRule * newStyleLemmatizeV3
                                                        );
                 Result = childcandidates ? childcandidates : addLemma(lemmas, defaultCandidate);
                 delete[] candidate.L;
+#if PRINTRULE
+                delete[] candidate.rule; // unless addLemma took it
+#endif
                 break;
                 }
             case 2:
@@ -1136,6 +1152,9 @@ static LemmaRule * newStyleLemmatizeV3
                                                  );
                 Result = childcandidates ? childcandidates : addLemma(lemmas, defaultCandidate);
                 delete[] candidate.L;
+#if PRINTRULE
+                delete[] candidate.rule; // unless addLemma took it
+#endif
                 break;
                 }
             default:
@@ -0,0 +1,89 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+#include "arena.h"
+#if defined PROGLEMMATISE
+#include <stdlib.h>
+#include <stdio.h>
+
+/* A block starts with a pointer to the next block, padded to ARENAALIGN
+   bytes. */
+#define NEXT(block) (*(char **)(block))
+#define PAYLOAD(block) ((block) + ARENAALIGN)
+
+arena * arena::current = NULL;
+
+/* Allocations that don't fit in the current block get a new block. Big ones
+   get a block of their own, which is put behind the current block, so that
+   the rest of the current block is still used. */
+void * arena::grow(size_t size)
+    {
+    bool big = size > ARENABLOCK / 4;
+    size_t blocksize = ARENAALIGN + (big ? size : ARENABLOCK);
+    char * block = (char *)malloc(blocksize);
+    if(!block)
+        {
+        fprintf(stderr,"Out of memory (%lu bytes).\n",(unsigned long)blocksize);
+        exit(-1);
+        }
+    if(big && blocks)
+        {
+        NEXT(block) = NEXT(blocks);
+        NEXT(blocks) = block;
+        return PAYLOAD(block);
+        }
+    NEXT(block) = blocks;
+    blocks = block;
+    top = PAYLOAD(block) + size;
+    end = block + blocksize;
+    return PAYLOAD(block);
+    }
+
+void arena::release()
+    {
+    if(!blocks)
+        return;
+    char * block = NEXT(blocks);
+    while(block)
+        {
+        char * next = NEXT(block);
+        free(block);
+        block = next;
+        }
+    NEXT(blocks) = NULL;
+    if(end - PAYLOAD(blocks) == ARENABLOCK)
+        top = PAYLOAD(blocks);
+    else // a big block, which is not worth keeping
+        {
+        free(blocks);
+        blocks = top = end = NULL;
+        }
+    }
+
+arena::~arena()
+    {
+    release();
+    free(blocks);
+    if(current == this)
+        current = NULL;
+    }
+
+#endif
@@ -0,0 +1,75 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "defines.h"
+#if defined PROGLEMMATISE
+#include <stddef.h>
+#include <string.h>
+
+/*
+Memory for the words of a text, their lemmas and the strings they own. Word,
+taggedWord, basefrm and baseformpointer objects are allocated in the current
+arena, which is the arena of the text that is being read or lemmatised.
+Deleting such an object runs its destructor, but its memory stays in the
+arena until the text releases the arena, all at once, after lemmatising.
+*/
+#define ARENABLOCK 0x10000 // bytes per block
+#define ARENAALIGN 8       // alignment of all allocations
+
+class arena
+    {
+    private:
+        char * blocks; // most recent block first. The current block is the first.
+        char * top;
+        char * end;
+        void * grow(size_t size);
+    public:
+        static arena * current;
+        arena():blocks(NULL),top(NULL),end(NULL){}
+        ~arena();
+        void * alloc(size_t size)
+            {
+            size = (size + ARENAALIGN - 1) & ~(size_t)(ARENAALIGN - 1);
+            if((size_t)(end - top) < size)
+                return grow(size);
+            void * ret = top;
+            top += size;
+            return ret;
+            }
+        char * copy(const char * s,size_t len) // len bytes of s, zero terminated
+            {
+            char * ret = (char *)alloc(len + 1);
+            memcpy(ret,s,len);
+            ret[len] = '\0';
+            return ret;
+            }
+        char * copy(const char * s)
+            {
+            return copy(s,strlen(s));
+            }
+        void release(); // Frees everything. Keeps the current block for reuse.
+    };
+
+#endif
+#endif
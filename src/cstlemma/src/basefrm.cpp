@@ -121,33 +121,48 @@ void basefrm::getAbsorbedBy(basefrm *other)
 
 basefrm::~basefrm()
 {
-    delete[] m_s; // Also deletes m_p ! (They are allocated as one string.)
-    delete[] m_t;
-    delete[] fullForm;
 #ifdef COUNTOBJECTS
     --COUNT;
 #endif
 }
 
+string basefrm::source() const
+{
+    string s(m_s);
+#if PRINTRULE
+    if (m_p)
+    {
+        s += '\v';
+        s += m_p;
+        s += '\v';
+        s += m_r();
+    }
+#endif
+    return s;
+}
+
+/* The lists of full forms are in the arena. A list has room for a power of
+   two full forms, so that it is only copied when its length reaches a power
+   of two. */
+static Word **newFullForms(unsigned int n)
+{
+    unsigned int size = 1;
+    while (size < n)
+        size <<= 1;
+    return (Word **)arena::current->alloc(size * sizeof(Word *));
+}
+
 void basefrm::addFullForm(Word *word)
 {
     assert(basefrm::hasW);
-    if (nfullForm > 0)
+    if ((nfullForm & (nfullForm - 1)) == 0) // 0 or a power of two: full
     {
-        Word **nwlist = new Word *[++nfullForm];
-        unsigned int i;
-        for (i = 0; i < (unsigned int)(nfullForm - 1); ++i)
+        Word **nwlist = newFullForms(nfullForm + 1);
+        for (unsigned int i = 0; i < nfullForm; ++i)
             nwlist[i] = fullForm[i];
-        nwlist[i] = word;
-        delete[] fullForm;
         fullForm = nwlist;
     }
-    else
-    {
-        nfullForm = 1;
-        fullForm = new Word *[1];
-        fullForm[0] = word;
-    }
+    fullForm[nfullForm++] = word;
 }
 
 void basefrm::L() const
@@ -235,10 +250,9 @@ void basefrm::addFullForms(basefrm *other)
 {
     assert(basefrm::hasW);
     int nnnfullForm = nfullForm + other->nfullForm;
-    int nnnfullFormOrg = nnnfullForm;
     if (nnnfullForm)
     {
-        Word **nwlist = new Word *[nnnfullForm];
+        Word **nwlist = newFullForms(nnnfullForm);
         unsigned int i, j, k;
         for (i = 0, j = 0, k = 0; i < nfullForm && j < other->nfullForm;)
         {
@@ -278,17 +292,7 @@ void basefrm::addFullForms(basefrm *other)
             nwlist[k++] = fullForm[i++];
         for (; j < other->nfullForm;)
             nwlist[k++] = other->fullForm[j++];
-        delete[] fullForm;
-        if (nnnfullForm != nnnfullFormOrg)
-        {
-            Word **nnwlist = new Word *[nnnfullForm];
-            for (int ind = 0; ind < nnnfullForm; ++ind)
-                nnwlist[ind] = nwlist[ind];
-            delete[] nwlist;
-            fullForm = nnwlist;
-        }
-        else
-            fullForm = nwlist;
+        fullForm = nwlist;
         nfullForm = nnnfullForm;
     }
 }
@@ -346,13 +350,13 @@ void basefrm::testPrint() const
 static void printOther(FILE *fpo, const char *s)
 {
     if (s)
-        fprintf(fpo, "%s", s);
+        fputs(s, fpo);
 }
 
 void basefrm::printToFile(const char *s) const
 {
     if (s)
-        fprintf(m_fp, "%s", s);
+        fputs(s, m_fp);
 }
 
 void (*print)(FILE *fpo, const char *s) = printOther;
@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "defines.h"
 #if defined PROGLEMMATISE
 #include "outputclass.h"
+#include "arena.h"
 #include <stdio.h>
 #include <string>
 #include <string.h>
@@ -98,6 +99,9 @@ public:
     static formattingFunction *getBasefrmFunctionNoW(int character, bool &DummySortInput, int &testType);
     static void setFile(FILE *a_fp);
 
+    const char *itsLemma() const { return m_s; }
+    const char *itsTag() const { return m_t; }
+    std::string source() const; // s as passed to the constructor
     int cmpf(const basefrm *b) const { return b->lemmaFreq() - lemmaFreq(); }
     int cmpt(const basefrm *b) const { return strcmp(m_t, b->m_t); }
     int cmps(const basefrm *b) const { return strcmp(m_s, b->m_s); }
@@ -108,17 +112,16 @@ public:
     }
 #endif
     baseformpointer &m_owner;
+    static void *operator new(size_t size) { return arena::current->alloc(size); }
+    static void operator delete(void *) {}
 #if PRINTRULE
     basefrm(const char *s, const char *t, baseformpointer &owner, size_t len /*int cnt,*/) : fullForm(NULL), nfullForm(0), m_owner(owner)
 #else
     basefrm(const char *s, const char *t, baseformpointer &owner, size_t len /*int cnt,*/) : fullForm(NULL), nfullForm(0), m_owner(owner)
 #endif
     {
-        this->m_s = new char[len + 1];
-        strncpy(this->m_s, s, len);
-        this->m_s[len] = '\0';
-        this->m_t = new char[strlen(t) + 1];
-        strcpy(this->m_t, t);
+        this->m_s = arena::current->copy(s, len);
+        this->m_t = arena::current->copy(t);
 #if PRINTRULE
         this->m_p = strchr(this->m_s, '\v');
         if (this->m_p)
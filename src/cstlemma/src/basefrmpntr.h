@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "defines.h"
 #if defined PROGLEMMATISE
 
+#include "arena.h"
 #include <stdio.h>
 #include <string>
 
@@ -77,12 +78,16 @@ public:
         baseformpointer(const char *s, const char *t, size_t len);
 #endif
         ~baseformpointer();
+        static void *operator new(size_t size) { return arena::current->alloc(size); }
+        static void operator delete(void *) {}
         void reassign(basefrm *bf);
 #if PFRQ || FREQ24
         int addBaseForm(const char *s, const char *t, size_t len, unsigned int frequency);
 #else
         int addBaseForm(const char *s, const char *t, size_t len);
 #endif
+        const basefrm *baseform() const { return bf; }
+        const baseformpointer *nextPointer() const { return next; }
         void assignTo(basefrm **&pbf)
         {
                 *pbf = bf;
@@ -0,0 +1,152 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "bloomfilter.h"
+#if (defined PROGLEMMATISE) || (defined PROGMAKEDICT)
+#include <string.h>
+#include <math.h>
+
+static tbloomhash mix(tbloomhash h) // MurmurHash3 finalizer
+    {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+    }
+
+bloomfilter::bloomfilter(tcount nkeys,double falsePositiveRate)
+    :bits(NULL),nbits(0),nhashes(0),owner(true),probes(0),rejects(0)
+    {
+    if(falsePositiveRate <= 0.0 || falsePositiveRate >= 1.0)
+        return;
+    double ln2 = log(2.0);
+    double bitsPerKey = -log(falsePositiveRate) / (ln2 * ln2);
+    double n = ceil((double)nkeys * bitsPerKey);
+    if(n < 64.0)
+        n = 64.0;
+    if(n > (double)INT_MAX)
+        return;
+    nbits = (INT32)n;
+    nhashes = (INT32)(bitsPerKey * ln2 + 0.5);
+    if(nhashes < 1)
+        nhashes = 1;
+    else if(nhashes > 30)
+        nhashes = 30;
+    bits = new unsigned char[(nbits + 7) / 8];
+    memset(bits,0,(nbits + 7) / 8);
+    }
+
+bloomfilter::bloomfilter(const char * image,size_t size)
+    :bits(NULL),nbits(0),nhashes(0),owner(false),probes(0),rejects(0)
+    {
+    if(size < sizeof(tbloomheader))
+        return;
+    const tbloomheader * header = (const tbloomheader *)image;
+    if(  header->nbits <= 0 
+      || header->nhashes <= 0
+      || size != sizeof(tbloomheader) + (header->nbits + 7) / 8
+      )
+        return;
+    nbits = header->nbits;
+    nhashes = header->nhashes;
+    bits = (unsigned char *)(image + sizeof(tbloomheader));
+    }
+
+bloomfilter::~bloomfilter()
+    {
+    if(owner)
+        delete [] bits;
+    }
+
+void bloomfilter::add(tbloomhash h)
+    {
+    h = mix(h);
+    unsigned int h1 = (unsigned int)h;
+    unsigned int h2 = (unsigned int)(h >> 32) | 1;
+    for(INT32 i = 0;i < nhashes;++i,h1 += h2)
+        {
+        unsigned int bit = (unsigned int)(((unsigned long long)h1 * (unsigned int)nbits) >> 32);
+        bits[bit >> 3] |= (unsigned char)(1 << (bit & 7));
+        }
+    }
+
+bool bloomfilter::mayContain(tbloomhash h)
+    {
+    ++probes;
+    h = mix(h);
+    unsigned int h1 = (unsigned int)h;
+    unsigned int h2 = (unsigned int)(h >> 32) | 1;
+    for(INT32 i = 0;i < nhashes;++i,h1 += h2)
+        {
+        unsigned int bit = (unsigned int)(((unsigned long long)h1 * (unsigned int)nbits) >> 32);
+        if(!(bits[bit >> 3] & (1 << (bit & 7))))
+            {
+            ++rejects;
+            return false;
+            }
+        }
+    return true;
+    }
+
+/* Add all full forms in the stretch of n nodes starting at 'at'.
+   h is the hash of the string that leads to the stretch. */
+void bloomfilter::addFullforms(const char * strings,const tindex * strs,const tindex * pos,const tchildren * nchildren,tcount at,int n,tbloomhash h)
+    {
+    for(tcount i = at;i < at + n;++i)
+        {
+        tbloomhash hi = bloomHash(h,strings + strs[i]);
+        if(pos[i] >= 0)
+            add(hi);
+        else
+            addFullforms(strings,strs,pos,nchildren,-pos[i],nchildren[i],hi);
+        }
+    }
+
+void bloomfilter::addFullforms(const char * (*nodestring)(tcount node,char * buf),const tindex * pos,const tchildren * nchildren,tcount at,int n,tbloomhash h)
+    {
+    char buf[DICTFCMAXSTRING];
+    for(tcount i = at;i < at + n;++i)
+        {
+        tbloomhash hi = bloomHash(h,nodestring(i,buf));
+        if(pos[i] >= 0)
+            add(hi);
+        else
+            addFullforms(nodestring,pos,nchildren,-pos[i],nchildren[i],hi);
+        }
+    }
+
+size_t bloomfilter::imageSize() const
+    {
+    return sizeof(tbloomheader) + (nbits + 7) / 8;
+    }
+
+void bloomfilter::writeImage(char * image) const
+    {
+    tbloomheader header;
+    header.nbits = nbits;
+    header.nhashes = nhashes;
+    memcpy(image,&header,sizeof(header));
+    memcpy(image + sizeof(header),bits,(nbits + 7) / 8);
+    }
+#endif
@@ -0,0 +1,74 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+#ifndef BLOOMFILTER_H
+#define BLOOMFILTER_H
+
+#include "defines.h"
+#if (defined PROGLEMMATISE) || (defined PROGMAKEDICT)
+#include "lem.h"
+#include <stddef.h>
+
+/*
+Bloom filter over the dictionary's full forms. It answers "definitely not in
+the dictionary" before the nodes are walked.
+The hash of a full form (FNV-1a) is computed incrementally, one node string
+at a time, so a filter can be filled while walking the nodes without
+constructing the full forms.
+*/
+typedef unsigned long long tbloomhash;
+
+#define BLOOMHASHINIT 14695981039346656037ULL
+
+inline tbloomhash bloomHash(tbloomhash h,const char * s)
+    {
+    for(;*s;++s)
+        h = (h ^ (unsigned char)*s) * 1099511628211ULL;
+    return h;
+    }
+
+class bloomfilter
+    {
+    private:
+        unsigned char * bits;
+        INT32 nbits;
+        INT32 nhashes;
+        bool owner; // false if bits are in a memory mapped dictionary
+    public:
+        unsigned long probes;  // number of calls to mayContain
+        unsigned long rejects; // number of times mayContain returned false
+        bloomfilter(tcount nkeys,double falsePositiveRate);
+        bloomfilter(const char * image,size_t size); // DS_BLOOM section
+        ~bloomfilter();
+        bool valid() const
+            {
+            return bits != NULL;
+            }
+        void add(tbloomhash h);
+        bool mayContain(tbloomhash h);
+        void addFullforms(const char * strings,const tindex * strs,const tindex * pos,const tchildren * nchildren,tcount at,int n,tbloomhash h);
+        // Same, with node strings that must be decoded (front coded)
+        void addFullforms(const char * (*nodestring)(tcount node,char * buf),const tindex * pos,const tchildren * nchildren,tcount at,int n,tbloomhash h);
+        size_t imageSize() const;
+        void writeImage(char * image) const;
+    };
+#endif
+#endif
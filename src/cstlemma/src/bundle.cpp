@@ -0,0 +1,364 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "bundle.h"
+#if defined PROGLEMMATISE
+#include "lem.h"
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#if defined _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <dirent.h>
+#endif
+
+static char * IMAGE = NULL; // The bundle, mapped or (if mapping is not
+                            // possible) read in one go.
+static size_t IMAGESIZE = 0;
+static bool IMAGEMAPPED = false;
+static const tbundleheader * HEADER = NULL;
+static const tbundleentry * INDEX = NULL;
+static signed char * VERIFIED = NULL; // per section: 0 not yet, 1 checksum
+                                      // is right, -1 checksum is wrong
+
+static tbundlesum checksum(const char * p,size_t n)
+    { // FNV-1a, eight bytes at a time
+    tbundlesum h = 14695981039346656037ULL;
+    for(;n >= sizeof(tbundlesum);p += sizeof(tbundlesum),n -= sizeof(tbundlesum))
+        {
+        tbundlesum w;
+        memcpy(&w,p,sizeof(w));
+        h = (h ^ w) * 1099511628211ULL;
+        }
+    for(;n > 0;++p,--n)
+        h = (h ^ (unsigned char)*p) * 1099511628211ULL;
+    return h;
+    }
+
+static unsigned long long align(unsigned long long offset)
+    {
+    return (offset + BUNDLEALIGN - 1) / BUNDLEALIGN * BUNDLEALIGN;
+    }
+
+void bundle::close()
+    {
+    if(IMAGE)
+        {
+#if !defined _WIN32
+        if(IMAGEMAPPED)
+            munmap(IMAGE,IMAGESIZE);
+        else
+#endif
+            free(IMAGE);
+        }
+    IMAGE = NULL;
+    IMAGESIZE = 0;
+    IMAGEMAPPED = false;
+    HEADER = NULL;
+    INDEX = NULL;
+    delete [] VERIFIED;
+    VERIFIED = NULL;
+    }
+
+bool bundle::isOpen()
+    {
+    return HEADER != NULL;
+    }
+
+/* Map the bundle. Returns 0, without a message, if the file cannot be
+   opened or is not a bundle. */
+int bundle::open(const char * filename)
+    {
+    close();
+    FILE * fp = fopen(filename,"rb");
+    if(!fp)
+        return 0;
+    char magic[sizeof(BUNDLEMAGIC) - 1];
+    if(  fread(magic,sizeof(magic),1,fp) != 1
+      || memcmp(magic,BUNDLEMAGIC,sizeof(magic))
+      || FSEEK(fp,0,SEEK_END) != 0
+      )
+        {
+        fclose(fp);
+        return 0;
+        }
+    LONG size = FTELL(fp);
+    if(size < (LONG)sizeof(tbundleheader))
+        {
+        fprintf(stderr,"Bundle: %s is too short.\n",filename);
+        fclose(fp);
+        return -1;
+        }
+    IMAGESIZE = (size_t)size;
+#if !defined _WIN32
+    IMAGE = (char *)mmap(NULL,IMAGESIZE,PROT_READ,MAP_PRIVATE,fileno(fp),0);
+    if(IMAGE == MAP_FAILED)
+        IMAGE = NULL;
+    else
+        IMAGEMAPPED = true;
+#endif
+    if(!IMAGE)
+        { // malloc returns memory that is aligned for any type.
+        IMAGE = (char *)malloc(IMAGESIZE);
+        rewind(fp);
+        if(!IMAGE || fread(IMAGE,IMAGESIZE,1,fp) != 1)
+            {
+            fprintf(stderr,"Bundle: cannot read %s.\n",filename);
+            fclose(fp);
+            close();
+            return -1;
+            }
+        }
+    fclose(fp);
+    const tbundleheader * header = (const tbundleheader *)IMAGE;
+    const tbundleentry * index = (const tbundleentry *)(header + 1);
+    bool ok = header->version == BUNDLEVERSION
+           && header->byteorder == DICTBYTEORDER
+           && header->nsections >= 0
+           && sizeof(tbundleheader) + (size_t)header->nsections * sizeof(tbundleentry) <= IMAGESIZE
+           && checksum((const char *)index,(size_t)header->nsections * sizeof(tbundleentry)) == header->checksum;
+    for(INT32 i = 0;ok && i < header->nsections;++i)
+        ok = memchr(index[i].name,'\0',BUNDLENAMELEN) != NULL
+          && index[i].offset % BUNDLEALIGN == 0
+          && index[i].offset <= IMAGESIZE
+          && index[i].size <= IMAGESIZE - index[i].offset;
+    if(!ok)
+        {
+        fprintf(stderr,"Bundle: %s is damaged or is not a bundle of version %d.\n",filename,BUNDLEVERSION);
+        close();
+        return -1;
+        }
+    HEADER = header;
+    INDEX = index;
+    VERIFIED = new signed char[header->nsections + 1];
+    memset(VERIFIED,0,header->nsections + 1);
+    return 1;
+    }
+
+const tbundleentry * bundle::find(const char * name)
+    {
+    if(HEADER)
+        {
+        for(INT32 i = 0;i < HEADER->nsections;++i)
+            if(!strcmp(INDEX[i].name,name))
+                return INDEX + i;
+        }
+    return NULL;
+    }
+
+/* The named section, or NULL if the bundle doesn't have it or if it is
+   damaged. */
+const char * bundle::section(const char * name,size_t & size,bool verify)
+    {
+    const tbundleentry * entry = find(name);
+    if(!entry)
+        return NULL;
+    signed char & verified = VERIFIED[entry - INDEX];
+    if(verify && !verified)
+        {
+        verified = checksum(IMAGE + entry->offset,(size_t)entry->size) == entry->checksum ? 1 : -1;
+        if(verified < 0)
+            fprintf(stderr,"Bundle: section %s is damaged.\n",name);
+        }
+    if(verified < 0)
+        return NULL;
+    size = (size_t)entry->size;
+    return IMAGE + entry->offset;
+    }
+
+/* The named section as a read-only stream, for the readers that read from
+   a file. The caller closes it. */
+FILE * bundle::stream(const char * name)
+    {
+    size_t size;
+    const char * p = section(name,size);
+    if(!p)
+        return NULL;
+    FILE * fp = NULL;
+#if !defined _WIN32
+    if(size > 0)
+        fp = fmemopen((void *)p,size,"rb");
+#endif
+    if(!fp)
+        {
+        fp = tmpfile();
+        if(fp)
+            {
+            if(size > 0 && fwrite(p,size,1,fp) != 1)
+                {
+                fclose(fp);
+                return NULL;
+                }
+            rewind(fp);
+            }
+        }
+    return fp;
+    }
+
+static bool readFile(const char * filename,std::string & contents)
+    {
+    FILE * fp = fopen(filename,"rb");
+    if(!fp)
+        return false;
+    char buf[65536];
+    size_t n;
+    while((n = fread(buf,1,sizeof(buf),fp)) > 0)
+        contents.append(buf,n);
+    bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+    }
+
+static bool isRuleFile(const std::string & contents)
+    {
+    return contents.size() >= 4
+        && (  !memcmp(contents.data(),"\0\0\0\0",4)
+           || !memcmp(contents.data(),"\rV3\r",4)
+           );
+    }
+
+/* The tags T for which there is a file <flx>.T */
+static void tagRuleFiles(const char * flx,std::vector<std::string> & tags)
+    {
+    std::string path(flx);
+    std::string::size_type slash = path.find_last_of("/\\");
+    std::string prefix = (slash == std::string::npos ? path : path.substr(slash + 1)) + ".";
+#if defined _WIN32
+    struct _finddata_t found;
+    intptr_t h = _findfirst((path + ".*").c_str(),&found);
+    if(h != -1)
+        {
+        do
+            {
+            if(!strncmp(found.name,prefix.c_str(),prefix.size()) && found.name[prefix.size()])
+                tags.push_back(found.name + prefix.size());
+            }
+        while(_findnext(h,&found) == 0);
+        _findclose(h);
+        }
+#else
+    std::string dir = slash == std::string::npos ? std::string(".") : path.substr(0,slash + 1);
+    DIR * d = opendir(dir.c_str());
+    if(d)
+        {
+        struct dirent * e;
+        while((e = readdir(d)) != NULL)
+            {
+            if(!strncmp(e->d_name,prefix.c_str(),prefix.size()) && e->d_name[prefix.size()])
+                tags.push_back(e->d_name + prefix.size());
+            }
+        closedir(d);
+        }
+#endif
+    std::sort(tags.begin(),tags.end());
+    }
+
+/* Write a bundle with the given files (any but flx can be NULL) and with
+   the tag specific rule files that are next to flx. */
+bool bundle::pack(FILE * fpout,const char * flx,const char * dictfile,const char * v,const char * x,const char * z)
+    {
+    const char * files[5] = {flx,dictfile,v,x,z};
+    const char * names[5] = {BS_FLEXRULES,BS_DICT,BS_TAGFRIENDS,BS_TYPETABLE,BS_LEMMATAGS};
+    std::vector<std::string> name;
+    std::vector<std::string> contents;
+    for(int i = 0;i < 5;++i)
+        {
+        if(files[i])
+            {
+            name.push_back(names[i]);
+            contents.push_back(std::string());
+            if(!readFile(files[i],contents.back()))
+                {
+                fprintf(stderr,"Bundle: cannot read %s.\n",files[i]);
+                return false;
+                }
+            }
+        }
+    if(!contents[0].compare(0,sizeof(BUNDLEMAGIC) - 1,BUNDLEMAGIC))
+        {
+        fprintf(stderr,"Bundle: %s is a bundle already.\n",flx);
+        return false;
+        }
+    if(dictfile && contents[1].compare(0,sizeof(DICTMAGIC) - 1,DICTMAGIC))
+        {
+        fprintf(stderr,"Bundle: %s is not a memory mappable dictionary. Make one with -D -G2.\n",dictfile);
+        return false;
+        }
+    std::vector<std::string> tags;
+    tagRuleFiles(flx,tags);
+    for(size_t t = 0;t < tags.size();++t)
+        {
+        std::string rules;
+        std::string filename = std::string(flx) + "." + tags[t];
+        if(!readFile(filename.c_str(),rules) || !isRuleFile(rules))
+            continue;
+        std::string section = std::string(BS_FLEXRULES ".") + tags[t];
+        if(section.size() >= BUNDLENAMELEN)
+            {
+            fprintf(stderr,"Bundle: %s left out, tag is too long.\n",filename.c_str());
+            continue;
+            }
+        name.push_back(section);
+        contents.push_back(rules);
+        }
+
+    INT32 n = (INT32)name.size();
+    std::vector<tbundleentry> index(n);
+    memset(&index[0],0,n * sizeof(tbundleentry));
+    unsigned long long offset = align(sizeof(tbundleheader) + n * sizeof(tbundleentry));
+    for(INT32 i = 0;i < n;++i)
+        {
+        strcpy(index[i].name,name[i].c_str());
+        index[i].offset = offset;
+        index[i].size = contents[i].size();
+        index[i].checksum = checksum(contents[i].data(),contents[i].size());
+        offset = align(offset + contents[i].size());
+        }
+    tbundleheader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,BUNDLEMAGIC,sizeof(header.magic));
+    header.version = BUNDLEVERSION;
+    header.byteorder = DICTBYTEORDER;
+    header.nsections = n;
+    header.checksum = checksum((const char *)&index[0],n * sizeof(tbundleentry));
+
+    static const char zeros[BUNDLEALIGN] = {0};
+    bool ok = fwrite(&header,sizeof(header),1,fpout) == 1
+           && fwrite(&index[0],sizeof(tbundleentry),n,fpout) == (size_t)n;
+    unsigned long long at = sizeof(header) + n * sizeof(tbundleentry);
+    for(INT32 i = 0;ok && i < n;++i)
+        {
+        if(index[i].offset > at)
+            ok = fwrite(zeros,(size_t)(index[i].offset - at),1,fpout) == 1;
+        if(ok && !contents[i].empty())
+            ok = fwrite(contents[i].data(),contents[i].size(),1,fpout) == 1;
+        at = index[i].offset + contents[i].size();
+        }
+    if(!ok)
+        fprintf(stderr,"Bundle: cannot write.\n");
+    return ok;
+    }
+#endif
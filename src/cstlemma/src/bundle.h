@@ -0,0 +1,94 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include "defines.h"
+#if defined PROGLEMMATISE
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+Model bundle: the flex rules, the dictionary, the tag friends, the type
+translation table, the lemma tags and the tag specific flex rules in one
+file, made with -Z. A bundle is given as the flex rules file (-f). Files that
+are given explicitly (-d, -v, -x, -z) take precedence over its sections.
+
+File layout, native byte order:
+
+    tbundleheader, tbundleentry index[nsections], sections
+
+Each section starts at a multiple of BUNDLEALIGN bytes from the start of the
+file, so that a memory mappable dictionary (see lem.h) can be used in place.
+The header has a checksum of the index, each index entry a checksum of its
+section. A section's checksum is verified the first time it is read. The
+dictionary, which is used in place, is not verified: that would read all of
+it, which is what mapping it avoids.
+*/
+#define BUNDLEMAGIC "CSTLBNDL"
+#define BUNDLEVERSION 1
+#define BUNDLEALIGN 64
+#define BUNDLENAMELEN 48
+
+/* Section names. The tag specific flex rules for tag T are in section
+   BS_FLEXRULES "." T, as they are in file <flex rules> "." T */
+#define BS_FLEXRULES "flexrules"   // -f
+#define BS_DICT "dict"             // -d, memory mappable format only
+#define BS_TAGFRIENDS "tagfriends" // -v
+#define BS_TYPETABLE "typetable"   // -x
+#define BS_LEMMATAGS "lemmatags"   // -z
+
+typedef unsigned long long tbundlesum;
+
+typedef struct
+    {
+    char magic[8];       // BUNDLEMAGIC, not zero terminated
+    INT32 version;       // BUNDLEVERSION
+    INT32 byteorder;     // DICTBYTEORDER
+    INT32 nsections;
+    INT32 unused;
+    tbundlesum checksum; // of index[]
+    } tbundleheader;
+
+typedef struct
+    {
+    char name[BUNDLENAMELEN]; // zero terminated
+    unsigned long long offset; // from start of file
+    unsigned long long size;   // in bytes
+    tbundlesum checksum;
+    } tbundleentry;
+
+class bundle
+    {
+    private:
+        static const tbundleentry * find(const char * name);
+    public:
+        static int open(const char * filename); // 1: bundle, 0: not a bundle, -1: error
+        static void close();
+        static bool isOpen();
+        static const char * section(const char * name,size_t & size,bool verify = true);
+        static FILE * stream(const char * name);
+        static bool pack(FILE * fpout,const char * flx,const char * dictfile,const char * v,const char * x,const char * z);
+    };
+
+#endif
+#endif
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 #include "caseconv.h"
 #include "utf8func.h"
+#include "letter.h"
 #include <string.h>
 
 int ENCODING = DEFAULTENCODING;
@@ -544,6 +545,83 @@ const char * allToLowerISO(const char * s)
     return ret;
     }
 
+size_t allToLowerBufISO(const char * s,char * buf,size_t size)
+    {
+    size_t l = strlen(s);
+    if(l < size)
+        {
+        if(!LowerEquivalent)
+            memcpy(buf,s,l + 1);
+        else
+            {
+            char * d = buf;
+            while(*s)
+                {
+                *d = (char)LowerEquivalent[*s & 0xFF];
+                ++d;
+                ++s;
+                }
+            *d = '\0';
+            }
+        }
+    return l;
+    }
+
+static size_t putUTF8char(unsigned int kar,char * d)
+    {
+    if(kar < 0x80)
+        {
+        d[0] = (char)kar;
+        return 1;
+        }
+    if(kar < 0x800)
+        {
+        d[0] = (char)(0xC0 | (kar >> 6));
+        d[1] = (char)(0x80 | (kar & 0x3F));
+        return 2;
+        }
+    if(kar < 0x10000)
+        {
+        d[0] = (char)(0xE0 | (kar >> 12));
+        d[1] = (char)(0x80 | ((kar >> 6) & 0x3F));
+        d[2] = (char)(0x80 | (kar & 0x3F));
+        return 3;
+        }
+    d[0] = (char)(0xF0 | (kar >> 18));
+    d[1] = (char)(0x80 | ((kar >> 12) & 0x3F));
+    d[2] = (char)(0x80 | ((kar >> 6) & 0x3F));
+    d[3] = (char)(0x80 | (kar & 0x3F));
+    return 4;
+    }
+
+size_t allToLowerBufUTF8(const char * s,char * buf,size_t size)
+    {
+    size_t l = 0;
+    while(*s)
+        {
+        char low[4];
+        size_t n;
+        bool UTF8 = true;
+        int kar = UTF8char(s,UTF8);
+        if(UTF8)
+            {
+            n = putUTF8char(lowerEquivalent(kar),low);
+            s += skipUTF8char(s);
+            }
+        else
+            { // not UTF-8: keep the byte
+            low[0] = *s++;
+            n = 1;
+            }
+        if(l + n < size)
+            memcpy(buf + l,low,n);
+        l += n;
+        }
+    if(l < size)
+        buf[l] = '\0';
+    return l;
+    }
+
 
 void AllToUpperISO(char * s)
     {
@@ -592,6 +670,7 @@ bool isUpper19(const char * s){return (UpperEquivalent[(int)(*s & 0xFF)] == (int
 bool (*is_Upper)(const char * s) = isUpper0;
 bool (*is_Alpha)(int k) = isAlphaISO;
 const char * (*allToLower)(const char * s);
+size_t (*allToLowerBuf)(const char * s,char * buf,size_t size) = allToLowerBufISO;
 int (*strcasecmpN)(const char *s, const char *p,ptrdiff_t & is,ptrdiff_t & ip) = strCaseCmpN0; // partly replaces Lower
 int (*strcmpN)(const char *s, const char *p,ptrdiff_t & is,ptrdiff_t & ip) = strCaseCmpN0; // partly replaces Lower
 
@@ -613,6 +692,7 @@ void setEncoding(int encoding)
         is_Upper = isUpperUTF8;
         is_Alpha = isAlpha;
         allToLower = allToLowerUTF8;
+        allToLowerBuf = allToLowerBufUTF8;
         strcasecmpN = strCaseCmpN;
         strcmpN = strCmpN;
         IsAllUpper = isAllUpperUTF8;
@@ -636,6 +716,7 @@ void setEncoding(int encoding)
             }
         is_Alpha = isAlphaISO;
         allToLower = allToLowerISO;
+        allToLowerBuf = allToLowerBufISO;
         IsAllUpper = isAllUpper;
         }
     }
@@ -64,6 +64,7 @@ extern int (*strcasecmpN)(const char *s, const char *p,ptrdiff_t & is,ptrdiff_t
 extern int (*strcmpN)(const char *s, const char *p,ptrdiff_t & is,ptrdiff_t & ip); // 20100303, increments to UTF-8 character boundaries
 extern bool (*is_Alpha)(int s);
 extern const char * (*allToLower)(const char * s);
+extern size_t (*allToLowerBuf)(const char * s,char * buf,size_t size); // reentrant allToLower, returns length of result, like snprintf
 extern bool (*IsAllUpper)(const char * s);
 enum class caseTp { easis, elower, emimicked }; // 
 
@@ -15,16 +15,33 @@
 using namespace std;
 
 PyObject *construct(PyObject *self, PyObject *args) {
-    char *flexFile, *dictFile;
-    PyArg_ParseTuple(args, "ss", &flexFile, &dictFile);
+    char *flexFile, *dictFile = NULL;
+    int background = 0;
+    char *warmCache = NULL;
+    char *delta = NULL;
+    unsigned long keep = 0;
+    PyArg_ParseTuple(args, "sz|pzzk", &flexFile, &dictFile, &background, &warmCache, &delta, &keep);
 
     optionStruct Option;
 
     Option.doSwitch('L', (char *)"", "");
     Option.doSwitch('f', flexFile, "");
-    Option.doSwitch('d', dictFile, "");
+    if (dictFile) // not needed with a model bundle
+        Option.doSwitch('d', dictFile, "");
     Option.doSwitch('c', (char *)"$b ", "");
     Option.doSwitch('b', (char *)"$w", "");
+    if (background)
+        Option.doSwitch('a', NULL, "");
+    if (warmCache)
+        Option.doSwitch('K', warmCache, "");
+    if (delta)
+        Option.doSwitch('O', delta, "");
+    if (keep)
+    {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%lu", keep);
+        Option.doSwitch('Q', buf, "");
+    }
 
     Lemmatiser *lemmatiser = new Lemmatiser(Option);
     
@@ -38,36 +55,91 @@ PyObject *lemmatiseString(PyObject *self, PyObject *args) {
     string str, result;
     PyObject *pobj;
     Py_ssize_t size;
+    int withStatus = 0;
+    bool dictConsulted;
     
     PyObject *lemmatiserCapsule_;
-    PyArg_ParseTuple(args, "OO", &lemmatiserCapsule_, &pobj);
+    PyArg_ParseTuple(args, "OO|p", &lemmatiserCapsule_, &pobj, &withStatus);
     str = PyUnicode_AsUTF8AndSize(pobj, &size);
     
     Lemmatiser *lemmatiser = (Lemmatiser *)PyCapsule_GetPointer(lemmatiserCapsule_, "lemmaPtr");
 
-    result = lemmatiser->LemmatiseString(str);
+    result = lemmatiser->LemmatiseString(str, &dictConsulted);
     
+    if (withStatus)
+        return Py_BuildValue("(NO)", PyUnicode_FromString(result.c_str()), dictConsulted ? Py_True : Py_False);
     return Py_BuildValue("O", PyUnicode_FromString(result.c_str()));
 }
 
 PyObject *lemmatiseStrings(PyObject *self, PyObject *args) {
     vector<string> s, result;
+    vector<bool> consulted;
     PyObject *pobj;
+    int withStatus = 0;
     
     PyObject *lemmatiserCapsule_;
-    PyArg_ParseTuple(args, "OO", &lemmatiserCapsule_, &pobj);
+    PyArg_ParseTuple(args, "OO|p", &lemmatiserCapsule_, &pobj, &withStatus);
     
     s = listToVectorString(pobj);
     
     Lemmatiser *lemmatiser = (Lemmatiser *)PyCapsule_GetPointer(lemmatiserCapsule_, "lemmaPtr");
 
     for (size_t i = 0; i < s.size(); i++) {
-        result.push_back(lemmatiser->LemmatiseString(s[i]));
+        bool dictConsulted;
+        result.push_back(lemmatiser->LemmatiseString(s[i], &dictConsulted));
+        consulted.push_back(dictConsulted);
     }
     
+    if (withStatus)
+        return vectorStringBoolToList(result, consulted);
     return vectorStringToList(result);
 }
 
+PyObject *waitUntilReady(PyObject *self, PyObject *args) {
+    PyObject *lemmatiserCapsule_;
+    PyArg_ParseTuple(args, "O", &lemmatiserCapsule_);
+    
+    Lemmatiser *lemmatiser = (Lemmatiser *)PyCapsule_GetPointer(lemmatiserCapsule_, "lemmaPtr");
+    bool ready;
+
+    Py_BEGIN_ALLOW_THREADS
+    ready = lemmatiser->waitUntilReady();
+    Py_END_ALLOW_THREADS
+    
+    return PyBool_FromLong(ready);
+}
+
+PyObject *dictionaryReady(PyObject *self, PyObject *args) {
+    PyObject *lemmatiserCapsule_;
+    PyArg_ParseTuple(args, "O", &lemmatiserCapsule_);
+    
+    Lemmatiser *lemmatiser = (Lemmatiser *)PyCapsule_GetPointer(lemmatiserCapsule_, "lemmaPtr");
+    
+    return PyBool_FromLong(lemmatiser->dictionaryReady());
+}
+
+PyObject *recordTraffic(PyObject *self, PyObject *args) {
+    PyObject *lemmatiserCapsule_;
+    Py_ssize_t nTypes;
+    PyArg_ParseTuple(args, "On", &lemmatiserCapsule_, &nTypes);
+    
+    Lemmatiser *lemmatiser = (Lemmatiser *)PyCapsule_GetPointer(lemmatiserCapsule_, "lemmaPtr");
+    lemmatiser->recordTraffic((size_t)nTypes);
+    
+    return Py_BuildValue("");
+}
+
+PyObject *saveWarmCache(PyObject *self, PyObject *args) {
+    PyObject *lemmatiserCapsule_;
+    char *fileName;
+    Py_ssize_t nTypes;
+    PyArg_ParseTuple(args, "Osn", &lemmatiserCapsule_, &fileName, &nTypes);
+    
+    Lemmatiser *lemmatiser = (Lemmatiser *)PyCapsule_GetPointer(lemmatiserCapsule_, "lemmaPtr");
+    
+    return PyBool_FromLong(lemmatiser->saveWarmCache(fileName, (size_t)nTypes));
+}
+
 PyObject *delete_object(PyObject *self, PyObject *args) {
     PyObject *lemmatiserCapsule_;
     PyArg_ParseTuple(args, "O", &lemmatiserCapsule_);
@@ -94,6 +166,22 @@ PyMethodDef cLemmatiserFunctions[] = {
       lemmatiseStrings, METH_VARARGS,
      "Lemmatise a list of strings"},
     
+    {"waitUntilReady",
+      waitUntilReady, METH_VARARGS,
+     "Block until the dictionary is loaded"},
+    
+    {"dictionaryReady",
+      dictionaryReady, METH_VARARGS,
+     "Whether the dictionary is loaded"},
+    
+    {"recordTraffic",
+      recordTraffic, METH_VARARGS,
+     "Record look-ups for a warm cache"},
+    
+    {"saveWarmCache",
+      saveWarmCache, METH_VARARGS,
+     "Write the most frequent recorded look-ups to a warm cache file"},
+    
     {"delete_object",
       delete_object, METH_VARARGS,
      "Delete `Lemmatiser` object"},
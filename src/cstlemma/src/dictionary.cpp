@@ -28,8 +28,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "utf8func.h"
 #include "caseconv.h"
+#include "bloomfilter.h"
+#include "tags.h"
 #include <string.h>
 #include <stdlib.h>
+#if !defined _WIN32
+#include <sys/mman.h>
+#endif
+#include <thread>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
 
 #ifdef COUNTOBJECTS
 int dictionary::COUNT = 0;
@@ -48,8 +59,8 @@ struct Nodes
                    // strings and children
     tchildren ntoplevel; // number of nodes at top level (for other levels, 
                          // this number is given by numberOfChildren)
-    int * initialchars;  // (optimization) string with all first characters. 
-                         //     (Not part of the dictionary file!)
+    INT32 * initialchars;// (optimization) string with all first characters. 
+                         //     (Not part of the old dictionary file format)
                          // First ntoplevel characters for each of the 
                          // ntoplevel nodes. May contain zero bytes!
                          // If first character of candidate string isn't in
@@ -61,8 +72,8 @@ struct Nodes
                          // string.
                          // Position of string to compare with can be computed
                          // from position of character in initialchars 
-    char ** strings; // array of strings. First ntoplevel strings are for 
-                     // each of the ntoplevel nodes.
+    tindex * strings; // array of indices into STRINGS. First ntoplevel 
+                      // strings are for each of the ntoplevel nodes.
                      // Full forms are encoded by stringing together the 
                      // appropriate *strings needed to reach the final 
                      // 'lext' structure.
@@ -73,26 +84,391 @@ struct Nodes
     tindex * pos; // zero or positive: index into lext array (LEXT)
                   // negative: inverse of index into initialchars, strings,
                   // numberOfChildren and pos
+    tindex toplevelASCII[128]; // (optimization) position of the top level
+                               // node that starts with the given ASCII
+                               // character, or -1. (Not part of the
+                               // dictionary file!)
+                               // Top level characters outside the ASCII
+                               // range are found by binary search in the
+                               // (sorted) first ntoplevel initialchars.
     };
 
+#define LINEARSEARCHMAX 8 // Stretches that are longer than this are
+                          // searched with binary search instead of a
+                          // linear scan.
+
 static char * STRINGS;
 static char * STRINGS1; // STRINGS1 = STRINGS + 1
 lext * LEXT;
 static Nodes NODES;
 static char EMPTY[] = "";
 
-bool dictionary::initdict(FILE * fpin)
+static char * IMAGE = NULL; // Dictionary file image (format version 2).
+                            // STRINGS, LEXT and NODES point into IMAGE.
+static size_t IMAGESIZE = 0;
+static bool IMAGEMAPPED = false; // IMAGE is memory mapped, not allocated.
+static bool IMAGEBORROWED = false; // IMAGE is owned by someone else (e.g. a
+                                   // model bundle).
+static INT32 * DABASE = NULL;  // Double-array trie (optional). If present, it
+static INT32 * DACHECK = NULL; // is used instead of NODES to find full forms.
+static INT32 DASIZE = 0;
+static bloomfilter * FILTER = NULL; // (optional) 
+static const tleafinfo * LEAFINFO = NULL; // (optional) Points into IMAGE.
+static const tindex * TYPES = NULL; // (optional) Points into IMAGE.
+static tcount NTYPES = 0;
+static tcount NLEXT = 0;
+static const INT32 * FCOFFSETS = NULL; // (optional) Front coded node strings.
+static const char * FCDATA = NULL;     // Point into IMAGE.
+static INT32 FCBLOCK = 0;
+static size_t NSTRINGS = 0; // size of STRINGS in bytes
+
+/*
+Delta dictionary (optional, see setDelta). A full form in the delta has the
+dictionary's readings of that full form, followed by the readings in the
+delta. The delta's strings are appended to a copy of STRINGS, which becomes
+lext::Strings, so that lext indices work the same for both.
+*/
+struct deltaReading // as read from the delta file
+    {
+    std::string fullform;
+    std::string type;
+    std::string lemma;
+    unsigned int frequency;
+    };
+
+typedef struct
+    {
+    tindex fullform; // index into DELTAFORMS
+    tcount first;    // index into DELTALEXT
+    int n;           // number of readings
+    int nmain;       // the first nmain readings are the dictionary's
+    } tdeltaentry;
+
+static std::vector<deltaReading> * DELTAREADINGS = NULL; // until applyDelta
+static INT32 * DELTASLOTS = NULL; // Open addressing hash table of entry
+                                  // indices + 1, 0 if empty. NULL if there
+                                  // is no delta.
+static INT32 DELTANSLOTS = 0;
+static tdeltaentry * DELTAENTRIES = NULL;
+static tcount NDELTAENTRIES = 0;
+static char * DELTAFORMS = NULL;
+static lext * DELTALEXT = NULL;
+static char * DELTASTRINGS = NULL; // STRINGS followed by the delta's strings
+static size_t DELTASIZE = 0; // bytes allocated for the above
+
+/*
+Batch look-up (see beginBatch). HINTS has the leaf of each word in the
+batch, HINTNEXT is the word that findword looks up next (see batchWord).
+*/
+typedef struct
+    {
+    const char * word;
+    tcount pos;  // -1 if the dictionary does not have word
+    int nmbr;
+    } tleafhint;
+
+static tleafhint * HINTS = NULL;
+static size_t NHINTS = 0;
+static size_t HINTNEXT = 0;
+static const tleafhint * HINT = NULL; // the walk that findwordSub can skip
+
+static bool READY = false; // Look-ups consult the dictionary. Only changed by
+                           // the thread that does the look-ups.
+static std::thread * LOADER = NULL; // (initdictAsync) Thread that loads the
+static std::atomic<int> LOADED(0);  // dictionary. LOADED: 0 while loading,
+                                    // 1 when done, -1 if loading failed.
+
+/* The string of node, which is decoded into buf (DICTFCMAXSTRING bytes) if
+   the node strings are front coded. */
+static const char * nodeString(tcount node,char * buf)
+    {
+    if(!FCDATA)
+        return STRINGS + NODES.strings[node];
+    tindex k = NODES.strings[node];
+    const char * p = FCDATA + FCOFFSETS[k / FCBLOCK];
+    size_t len = strlen(p);
+    memcpy(buf,p,len + 1);
+    p += len + 1;
+    for(tindex n = k % FCBLOCK;n > 0;--n)
+        {
+        size_t shared = (unsigned char)*p++;
+        len = strlen(p);
+        memcpy(buf + shared,p,len + 1);
+        p += len + 1;
+        }
+    return buf;
+    }
+
+/* nodeString decodes into a buffer of DICTFCMAXSTRING bytes without
+   checking, so check once that each node has a string number below
+   nstrings and that each string fits in that buffer and ends before end. */
+static bool validFrontCoded(INT32 nstrings,const char * end,size_t nnodes)
+    {
+    size_t i;
+    for(i = 0;i < nnodes;++i)
+        if(NODES.strings[i] < 0 || NODES.strings[i] >= (tindex)nstrings)
+            return false;
+    for(INT32 k = 0;k < nstrings;k += FCBLOCK)
+        {
+        INT32 offset = FCOFFSETS[k / FCBLOCK];
+        if(offset < 0 || offset >= end - FCDATA)
+            return false;
+        const char * p = FCDATA + offset;
+        size_t len = 0;
+        for(INT32 n = 0;n < FCBLOCK && k + n < nstrings;++n)
+            {
+            size_t shared = 0;
+            if(n > 0)
+                {
+                if(p >= end)
+                    return false;
+                shared = (unsigned char)*p++;
+                if(shared > len)
+                    return false;
+                }
+            const char * z = (const char *)memchr(p,'\0',end - p);
+            if(!z || shared + (z - p) >= DICTFCMAXSTRING)
+                return false;
+            len = shared + (z - p);
+            p = z + 1;
+            }
+        }
+    return true;
+    }
+
+/* The bytes that load() reads to look for DICTMAGIC. The old format is
+   read from HEAD first and then from the file, so that a dictionary can be
+   read from a pipe, without seeking back. */
+static char HEAD[sizeof(DICTMAGIC) - 1];
+static size_t HEADLEN = 0;
+static size_t HEADPOS = 0;
+
+/* Like fread(buf,size,1,fp) == 1, for the old format. */
+static bool readOld(void * buf,size_t size,FILE * fp)
+    {
+    size_t n = HEADLEN - HEADPOS;
+    if(n > size)
+        n = size;
+    memcpy(buf,HEAD + HEADPOS,n);
+    HEADPOS += n;
+    return n == size || fread((char *)buf + n,size - n,1,fp) == 1;
+    }
+
+/*
+BloomRate < 0: do not use a Bloom filter
+BloomRate = 0: use the dictionary's Bloom filter, if it has one
+BloomRate > 0: if the dictionary has no Bloom filter, make one with this
+               false positive rate
+*/
+bool dictionary::initdict(FILE * fpin,double BloomRate)
+    {
+    READY = load(fpin,BloomRate);
+    if(READY)
+        {
+        registerTypes();
+        applyDelta();
+        }
+    return READY;
+    }
+
+/* Same, for a memory mappable dictionary that is already in memory (see
+   readImage). */
+bool dictionary::initdict(const char * image,size_t size,double BloomRate)
+    {
+    READY = readImage(image,size);
+    if(READY)
+        {
+        makeFilter(BloomRate);
+        registerTypes();
+        applyDelta();
+        }
+    return READY;
+    }
+
+void dictionary::backgroundLoad(FILE * fpin,double BloomRate)
+    {
+    LOADED = load(fpin,BloomRate) ? 1 : -1;
+    fclose(fpin);
+    }
+
+/*
+Load the dictionary in a background thread, which closes fpin. Until the
+dictionary is loaded, findword finds nothing.
+*/
+void dictionary::initdictAsync(FILE * fpin,double BloomRate)
+    {
+    LOADED = 0;
+    LOADER = new std::thread(backgroundLoad,fpin,BloomRate);
+    }
+
+/* Join the loader thread and, if it succeeded, let look-ups use the
+   dictionary. Registering the types is done here, and not in the loader
+   thread, because other threads may read the tag registry. */
+void dictionary::finishLoading()
+    {
+    LOADER->join();
+    delete LOADER;
+    LOADER = NULL;
+    if(LOADED > 0)
+        {
+        registerTypes();
+        applyDelta();
+        READY = true;
+        }
+    }
+
+/* Whether look-ups consult the dictionary. Does not block. */
+bool dictionary::poll()
+    {
+    if(LOADER && LOADED != 0)
+        finishLoading();
+    return READY;
+    }
+
+/* Whether a background load has not been published yet. */
+bool dictionary::loading()
+    {
+    return LOADER != NULL;
+    }
+
+/* Block until a background load (if any) is done. Returns true if the
+   dictionary is available. */
+bool dictionary::waitUntilReady()
+    {
+    if(LOADER)
+        finishLoading();
+    return READY;
+    }
+
+/* Read the dictionary. Runs in the loader thread if initdictAsync is used,
+   so it must not touch state that is shared with other threads. */
+bool dictionary::load(FILE * fpin,double BloomRate)
     {
     if(fpin)
         {
-        return readStrings(fpin) && readLeaves(fpin) && readNodes(fpin);
+        bool ok;
+        HEADLEN = fread(HEAD,1,sizeof(HEAD),fpin);
+        HEADPOS = 0;
+        if(HEADLEN == sizeof(HEAD) && !memcmp(HEAD,DICTMAGIC,sizeof(HEAD)))
+            ok = readImage(fpin);
+        else // Old format
+            ok = readStrings(fpin) && readLeaves(fpin) && readNodes(fpin);
+        if(ok)
+            makeFilter(BloomRate);
+        return ok;
         }
     return false;
     }
 
+/* Tell the tag registry where each type is in STRINGS, so that tags can be
+   compared with lext::iType instead of with lext::Type(). */
+void dictionary::registerTypes()
+    {
+    if(TYPES)
+        {
+        for(tcount i = 0;i < NTYPES;++i)
+            tagregistry::setDictType(tagregistry::add(STRINGS + TYPES[i]),TYPES[i]);
+        }
+    else
+        {
+        tindex prev = -1;
+        for(tcount i = 0;i < NLEXT;++i)
+            {
+            if(LEXT[i].iType != prev)
+                {
+                prev = LEXT[i].iType;
+                tagregistry::setDictType(tagregistry::add(STRINGS + prev),prev);
+                }
+            }
+        }
+    }
+
+void dictionary::makeFilter(double BloomRate)
+    {
+    if(BloomRate < 0.0)
+        {
+        delete FILTER;
+        FILTER = NULL;
+        }
+    else if(!FILTER && BloomRate > 0.0)
+        {
+        tcount nfullforms = 0;
+        for(tcount i = 0;i < NODES.nnodes;++i)
+            if(NODES.pos[i] >= 0)
+                ++nfullforms;
+        FILTER = new bloomfilter(nfullforms,BloomRate);
+        if(FILTER->valid())
+            FILTER->addFullforms(nodeString,NODES.pos,NODES.numberOfChildren,0,NODES.ntoplevel,BLOOMHASHINIT);
+        else
+            {
+            delete FILTER;
+            FILTER = NULL;
+            }
+        }
+    }
+
+/* Precomputed disambiguation data for the readings starting at plext, or
+   NULL if the dictionary has none. See lem.h */
+const tleafinfo * dictionary::leafInfo(const lext * plext)
+    {
+    if(!LEAFINFO || (DELTALEXT && (plext < LEXT || plext >= LEXT + NLEXT)))
+        return NULL;
+    return LEAFINFO + (plext - LEXT);
+    }
+
+bool dictionary::filterStatistics(unsigned long & probes,unsigned long & rejects)
+    {
+    if(READY && FILTER)
+        {
+        probes = FILTER->probes;
+        rejects = FILTER->rejects;
+        return true;
+        }
+    return false;
+    }
+
+/* Count the filter look-ups of another process (-j). */
+void dictionary::addFilterStatistics(unsigned long probes,unsigned long rejects)
+    {
+    if(FILTER)
+        {
+        FILTER->probes += probes;
+        FILTER->rejects += rejects;
+        }
+    }
+
+bool dictionary::memory(tdictmemory & mem)
+    {
+    if(!READY)
+        return false;
+    size_t nnodes = (size_t)NODES.nnodes;
+    mem.nodes = nnodes * (sizeof(INT32) + 2 * sizeof(tindex) + sizeof(tchildren));
+    mem.trie = 2 * (size_t)DASIZE * sizeof(INT32);
+    mem.filter = FILTER ? FILTER->imageSize() : 0;
+    mem.delta = DELTASIZE;
+    mem.mapped = IMAGEMAPPED || IMAGEBORROWED; // a bundle is mapped if possible
+    if(IMAGE)
+        {
+        const tdictheader * header = (const tdictheader *)IMAGE;
+        mem.strings = (size_t)header->section[DS_STRINGS].size
+                    + (size_t)header->section[DS_FCSTRINGS].size;
+        mem.readings = (size_t)header->section[DS_LEXT].size
+                     + (size_t)header->section[DS_LEAFINFO].size
+                     + (size_t)header->section[DS_TYPES].size;
+        }
+    else
+        {
+        mem.strings = NSTRINGS;
+        mem.readings = (size_t)NLEXT * sizeof(lext);
+        }
+    return true;
+    }
+
 dictionary::dictionary()
     {
     NODES.ntoplevel = 0;
+    for(int k = 0;k < 128;++k)
+        NODES.toplevelASCII[k] = -1;
 #ifdef COUNTOBJECTS
     ++COUNT = 0;
 #endif
@@ -100,12 +476,24 @@ dictionary::dictionary()
 
 dictionary::~dictionary()
     {
-    cleanup();
+    close();
 #ifdef COUNTOBJECTS
     --COUNT = 0;
 #endif
     }
 
+/* Stop using the dictionary and release it. Must be done before the image
+   that initdict(image,size,...) borrowed goes away. */
+void dictionary::close()
+    {
+    waitUntilReady();
+    READY = false;
+    endBatch();
+    tagregistry::clearDictTypes();
+    cleanup();
+    clearDelta();
+    }
+
 void dictionary::printall(FILE * fp)
     {
     for(tchildrencount i = 0;i < NODES.ntoplevel;++i)
@@ -122,104 +510,424 @@ void dictionary::printall2(FILE * fp)
         }
     }
 
-bool dictionary::findword(const char * word, const char * tag, tcount & Pos,int & Nmbr)
+/* Look up word and, if that fails and word is capitalised, its lower case
+   variant. Both variants share the walk through their common prefix: the
+   lower case look-up resumes from where the exact walk forked. */
+bool dictionary::findword(const char * word, const char * tag, lext *& Plext,int & Nmbr)
     {
-    if(findwordSub(word,tag,Pos,Nmbr))
+    if(!READY)
+        return false;
+    walkState start = {0,0,(int)NODES.ntoplevel,0};
+    if(HINTNEXT < NHINTS && HINTS[HINTNEXT].word == word)
+        HINT = HINTS + HINTNEXT;
+    if(!is_Upper(word))
         {
-        return true;
+        bool found = findwordSub(word,tag,start,-1,NULL,Plext,Nmbr);
+        HINT = NULL;
+        return found;
         }
-    else if(is_Upper(word))
-        return findwordSub(allToLower(word), tag, Pos,Nmbr);
+    char buf[256];
+    char * lower = buf;
+    size_t len = allToLowerBuf(word,buf,sizeof(buf));
+    if(len >= sizeof(buf))
+        {
+        lower = new char[len + 1];
+        allToLowerBuf(word,lower,len + 1);
+        }
+    ptrdiff_t shared = 0;
+    while(word[shared] && word[shared] == lower[shared])
+        ++shared;
+    bool found;
+    if(!word[shared] && !lower[shared]) // e.g. digits: lower case is the same
+        found = findwordSub(word,tag,start,-1,NULL,Plext,Nmbr);
     else
-        return false;
+        {
+        walkState fork = start; // stays at the top level if HINT skips the walk
+        found = findwordSub(word,tag,start,shared,&fork,Plext,Nmbr);
+        HINT = NULL;
+        found = found || findwordSub(lower,tag,fork,-1,NULL,Plext,Nmbr);
+        }
+    HINT = NULL;
+    if(lower != buf)
+        delete [] lower;
+    return found;
     }
 
-bool dictionary::findwordSub(const char * word, const char * tag, tcount & Pos,int & Nmbr)
+/* Return position of the node in the stretch [pos, pos+nmbr) that has
+   initial character kar, or -1 if there is no such node. The initial
+   characters in a stretch are sorted. */
+static tcount findInStretch(tcount pos,int nmbr,int kar)
     {
-    int kar = UTF8char(word,staticUTF8);
-    const char * w = word;
-    int nmbr = NODES.ntoplevel;
-    tcount pos = 0;
-    while(nmbr > 0)
+    if(nmbr > LINEARSEARCHMAX)
+        {
+        const INT32 * first = NODES.initialchars + pos;
+        const INT32 * last = first + nmbr;
+        while(first < last)
+            {
+            const INT32 * mid = first + (last - first) / 2;
+            if(*mid < kar)
+                first = mid + 1;
+            else
+                last = mid;
+            }
+        if(first < NODES.initialchars + pos + nmbr && *first == kar)
+            return (tcount)(first - NODES.initialchars);
+        return -1;
+        }
+    for(;nmbr > 0;++pos,--nmbr)
         {
         int kar2 = NODES.initialchars[pos];
-        if(kar2 < kar)
+        if(kar2 == kar)
+            return pos;
+        else if(kar2 > kar) // Initial character alphabetically greater than
+                            // any of the available candidates.
+            return -1;
+        }
+    return -1;
+    }
+
+static tcount findTopLevel(int kar)
+    {
+    if(0 <= kar && kar < 128)
+        return NODES.toplevelASCII[kar];
+    return findInStretch(0,NODES.ntoplevel,kar);
+    }
+
+/* One step of a walk through the nodes: match the node in the stretch
+   (stretch, length) that w continues with. Returns 1 if w has reached a
+   leaf (pos, nmbr: its readings), 0 if the dictionary does not have the
+   word, and -1 if the walk continues at the new w, stretch and length. */
+static inline int leafStep(const char *& w,tcount & stretch,int & length,tcount & pos,int & nmbr)
+    {
+    int kar = UTF8char(w,staticUTF8);
+    pos = stretch ? findInStretch(stretch,length,kar) : findTopLevel(kar);
+    if(pos < 0)
+        return 0;
+    bool wMatched = false;
+    if(kar)
+        {
+        ptrdiff_t p,q;
+        char buf[DICTFCMAXSTRING];
+        const char * s = nodeString(pos,buf);
+        strcmpN(s,w,p,q);
+        if(s[p])
+            return 0;
+        w += q;
+        wMatched = true; // 20210308
+        }
+    nmbr = NODES.numberOfChildren[pos];
+    pos = NODES.pos[pos];
+    if(pos < 0) // not a leaf, descend further
+        {
+        stretch = -pos; // -pos: Make it a valid index.
+        length = nmbr;
+        return -1;
+        }
+    else if(*w && (*++w||wMatched))
+        { /* 20210308
+             The dictionary word is too short, and the dictionary does
+             not contain the full word. */
+        return 0;
+        }
+    else // This is a leaf.
+        return 1;
+    }
+
+/* One step of a walk through the double-array trie: follow the byte at w,
+   or, at the end of the word, find the leaf. Returns as leafStep. */
+static inline int stepDA(const char *& w,INT32 & state,tcount & pos,int & nmbr)
+    {
+    if(*w)
+        {
+        INT32 next = DABASE[state] + (unsigned char)*w + 1;
+        if(next >= DASIZE || DACHECK[next] != state)
+            return 0;
+        state = next;
+        ++w;
+        return -1;
+        }
+    INT32 end = DABASE[state];
+    if(end < 0 || end >= DASIZE || DACHECK[end] != state)
+        return 0;
+    tcount leaf = -DABASE[end] - 1;
+    pos = NODES.pos[leaf];
+    nmbr = NODES.numberOfChildren[leaf];
+    return 1;
+    }
+
+/* Find the leaf node for word by walking the nodes, starting from the
+   stretch at which the first at.done bytes of word have been matched.
+   While no more than shared bytes are matched, the state is copied to fork.
+   (A stretch of 0 is the top level.) */
+static bool findLeaf(const char * word,const walkState & at,ptrdiff_t shared,walkState * fork,tcount & pos,int & nmbr)
+    {
+    const char * w = word + at.done;
+    tcount stretch = at.stretch;
+    int length = at.length;
+    int found;
+    do
+        {
+        if(fork && w - word <= shared)
             {
-            ++pos;
-            --nmbr;
+            fork->done = w - word;
+            fork->stretch = stretch;
+            fork->length = length;
             }
-        else if(kar2 == kar)
+        found = leafStep(w,stretch,length,pos,nmbr);
+        }
+    while(found < 0);
+    return found > 0;
+    }
+
+/* Find the leaf node for word in the double-array trie, starting from
+   at.state. Same fork semantics as findLeaf. */
+static bool findLeafDA(const char * word,const walkState & at,ptrdiff_t shared,walkState * fork,tcount & pos,int & nmbr)
+    {
+    INT32 state = at.state;
+    const char * w = word + at.done;
+    int found;
+    do
+        {
+        if(fork && w - word <= shared)
             {
-            bool wMatched = false;
-            if(kar)
-                {
-                ptrdiff_t p,q;
-                char * s = NODES.strings[pos];
-                strcmpN(s,w,p,q);
-                if(s[p])
-                    return false;
-                w += q;
-                wMatched = true; // 20210308
-                }
-            nmbr = NODES.numberOfChildren[pos];
-            pos = NODES.pos[pos];
-            if(pos < 0) // not a leaf, descend further
-                {
-                pos = -pos; // Make it a valid index.
-                kar = UTF8char(w,staticUTF8);
-                }
-            else if(*w && (*++w||wMatched))
-                { /* 20210308
-                     The dictionary word is too short, and the dictionary does
-                     not contain the full word. */
-                return false;
-                }
-            else // This is a leaf. Do the baseform and type stuff.
-                {
-                if (tag)
-                    {
-                    lext * plext;
-                    const char * Tp = Lemmatiser::translate(tag); // tag as found in the text
-                                                                    // See whether the word's tag can be found in the
-                                                                    // dictionary's lexical information.
-                    plext = LEXT + pos;
-                    int m;
+            fork->done = w - word;
+            fork->state = state;
+            }
+        found = stepDA(w,state,pos,nmbr);
+        }
+    while(found < 0);
+    return found > 0;
+    }
+
+/*
+Batch look-up. beginBatch finds the leaves of a sorted list of words with
+WALKERS interleaved walks, each through a contiguous part of the list. A
+walk does one step (one node, or one byte in the double-array trie) and
+prefetches what the next step reads, and then the next walk has its turn,
+so that the walks wait for memory at the same time rather than one after
+the other. A walk starts from the deepest state that its word shares with
+the previous word of the walk.
+Without a double-array trie, there is only one walk: walks through the
+nodes of sorted words already find most nodes in the cache, and interleaved
+walks were slower.
+*/
+#define WALKERS 8
 
-                    const char * baseTp = LemmaTag(Tp);
+#if defined __GNUC__
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p)
+#endif
 
-                    unsigned int maxFreq = Word::maxFrequency(LEXT, nmbr, baseTp, m);
+struct walker
+    {
+    size_t next;   // index of the word being walked
+    size_t end;
+    const char * prev;
+    std::vector<walkState> path; // walk of the current (previous) word at
+                                 // its node boundaries (at each byte in the
+                                 // double-array trie), the top level first
+    };
 
-                    for (int n = nmbr; n; --n, ++plext)
-                        {
-                        if (plext->S.frequency >= maxFreq)
-                            {
-                            if (!strcmp(Tp, (plext->Type))) // Word is in dictionary,
-                                {
-                                Pos = pos;
-                                Nmbr = nmbr;
-                                return true;
-                                }
-                            }
-                        }
-                    return false;
-                    }
-                else
-                    {
-                    Pos = pos;
-                    Nmbr = nmbr;
-                    return true;
-                    }
-                }
+static void prefetchState(const walkState & at)
+    {
+    if(DABASE)
+        PREFETCH(DABASE + at.state);
+    else if(at.stretch)
+        {
+        PREFETCH(NODES.initialchars + at.stretch);
+        PREFETCH(NODES.strings + at.stretch);
+        PREFETCH(NODES.numberOfChildren + at.stretch);
+        PREFETCH(NODES.pos + at.stretch);
+        }
+    }
+
+/* Set up the walk for the next word of wk that the Bloom filter does not
+   reject. Returns false if wk has no more words. */
+static bool startWalk(walker & wk,const char * const * words)
+    {
+    for(;wk.next < wk.end;++wk.next)
+        {
+        const char * word = words[wk.next];
+        ptrdiff_t shared = 0;
+        while(word[shared] && word[shared] == wk.prev[shared])
+            ++shared;
+        while(wk.path.back().done > shared)
+            wk.path.pop_back();
+        wk.prev = word;
+        if(FILTER && !FILTER->mayContain(bloomHash(BLOOMHASHINIT,word)))
+            {
+            HINTS[wk.next].word = word;
+            HINTS[wk.next].pos = -1;
+            HINTS[wk.next].nmbr = 0;
+            continue;
             }
-        else // Initial character alphabetically greater than any of the
-             // available candidates.
+        prefetchState(wk.path.back());
+        return true;
+        }
+    return false;
+    }
+
+/* Do one step of the walk of wk. Returns false if wk has no more words. */
+static bool stepWalk(walker & wk,const char * const * words)
+    {
+    const char * word = words[wk.next];
+    walkState at = wk.path.back();
+    const char * w = word + at.done;
+    tcount pos = -1;
+    int nmbr = 0;
+    int found = DABASE ? stepDA(w,at.state,pos,nmbr) : leafStep(w,at.stretch,at.length,pos,nmbr);
+    if(found < 0)
+        {
+        at.done = w - word;
+        wk.path.push_back(at);
+        prefetchState(at);
+        return true;
+        }
+    HINTS[wk.next].word = word;
+    HINTS[wk.next].pos = found ? pos : -1;
+    HINTS[wk.next].nmbr = nmbr;
+    ++wk.next;
+    return startWalk(wk,words);
+    }
+
+/* Find the leaves of the n words, which must be sorted. Until endBatch,
+   findword uses them instead of walking the dictionary. Call batchWord
+   before looking up a word of the batch. */
+void dictionary::beginBatch(const char * const * words,size_t n)
+    {
+    endBatch();
+    if(!READY || n == 0)
+        return;
+    HINTS = new tleafhint[n];
+    NHINTS = n;
+    walkState top = {0,0,(int)NODES.ntoplevel,0};
+    walker walkers[WALKERS];
+    int nwalkers = DABASE ? WALKERS : 1;
+    int active = 0;
+    for(int k = 0;k < nwalkers;++k)
+        {
+        walker & wk = walkers[active];
+        wk.next = n * k / nwalkers;
+        wk.end = n * (k + 1) / nwalkers;
+        wk.prev = "";
+        wk.path.assign(1,top);
+        if(startWalk(wk,words))
+            ++active;
+        }
+    while(active > 0)
+        {
+        for(int k = 0;k < active;)
             {
-            return false;
+            if(stepWalk(walkers[k],words))
+                ++k;
+            else
+                std::swap(walkers[k],walkers[--active]);
+            }
+        }
+    }
+
+/* The next findword is for word i of the batch. */
+void dictionary::batchWord(size_t i)
+    {
+    HINTNEXT = i;
+    }
+
+void dictionary::endBatch()
+    {
+    delete [] HINTS;
+    HINTS = NULL;
+    NHINTS = 0;
+    HINTNEXT = 0;
+    }
+
+/* Whether one of the nmbr readings at base + pos, with the highest
+   frequency among the readings with the lemma type of tag, has type tag. */
+static bool typeMatches(lext * base,tcount pos,int nmbr,const char * tag)
+    {
+    const char * Tp = Lemmatiser::translate(tag); // tag as found in the text
+                                                    // See whether the word's tag can be found in the
+                                                    // dictionary's lexical information.
+    tindex iTp = tagregistry::dictType(Tp);
+    if(iTp < 0) // No reading can have this type.
+        return false;
+    lext * plext = base + pos;
+    int m;
+
+    const char * baseTp = LemmaTag(Tp);
+
+    unsigned int maxFreq = Word::maxFrequency(base, nmbr, baseTp, m);
+
+    for (int n = nmbr; n; --n, ++plext)
+        {
+        if (plext->S.frequency >= maxFreq)
+            {
+            if (plext->iType == iTp) // Word is in dictionary,
+                return true;
             }
         }
     return false;
     }
 
+bool dictionary::findwordSub(const char * word, const char * tag, const walkState & at, ptrdiff_t shared, walkState * fork, lext *& Plext,int & Nmbr)
+    {
+    tcount pos;
+    int nmbr;
+    if(DELTASLOTS)
+        {
+        int found = findDelta(word,tag,Plext,Nmbr);
+        if(found >= 0)
+            return found > 0;
+        }
+    if(HINT) // beginBatch has walked word
+        {
+        pos = HINT->pos;
+        nmbr = HINT->nmbr;
+        if(pos < 0)
+            return false;
+        }
+    else
+        {
+        if(FILTER && !FILTER->mayContain(bloomHash(BLOOMHASHINIT,word)))
+            return false;
+        if(!(DABASE ? findLeafDA(word,at,shared,fork,pos,nmbr) : findLeaf(word,at,shared,fork,pos,nmbr)))
+            return false;
+        }
+    // Do the baseform and type stuff.
+    if (tag && !typeMatches(LEXT,pos,nmbr,tag))
+        return false;
+    Plext = LEXT + pos;
+    Nmbr = nmbr;
+    return true;
+    }
+
+static unsigned int deltaHash(const char * word)
+    {
+    unsigned int h = 2166136261u; // FNV-1a
+    for(const unsigned char * p = (const unsigned char *)word;*p;++p)
+        h = (h ^ *p) * 16777619u;
+    return h;
+    }
+
+/* Look up word in the delta dictionary. Returns -1 if the delta does not
+   have word, so that the dictionary must be consulted, 0 if the delta has
+   word, but not with tag, and 1 if found. */
+int dictionary::findDelta(const char * word, const char * tag, lext *& Plext,int & Nmbr)
+    {
+    for(INT32 i = deltaHash(word) & (DELTANSLOTS - 1);DELTASLOTS[i];i = (i + 1) & (DELTANSLOTS - 1))
+        {
+        const tdeltaentry * e = DELTAENTRIES + DELTASLOTS[i] - 1;
+        if(!strcmp(DELTAFORMS + e->fullform,word))
+            {
+            if (tag && !typeMatches(DELTALEXT + e->first,0,e->n,tag))
+                return 0;
+            Plext = DELTALEXT + e->first;
+            Nmbr = e->n;
+            return 1;
+            }
+        }
+    return -1;
+    }
 
 /*
 Structure of dictionary file.
@@ -235,12 +943,14 @@ STRINGS1 = {#STRINGS1}{STRINGS1}
 bool dictionary::readStrings(FILE * fp)
     {
     tlength stringBufLen;
-    if(fread(&stringBufLen,sizeof(stringBufLen),1,fp) == 1)
+    if(readOld(&stringBufLen,sizeof(stringBufLen),fp))
         {
         STRINGS = new char[stringBufLen+1];
+        NSTRINGS = (size_t)stringBufLen + 1;
         STRINGS[0] = '\0';
         STRINGS1 = STRINGS + 1;
-        return fread(STRINGS1,stringBufLen,1,fp) == 1;
+        lext::Strings = STRINGS;
+        return readOld(STRINGS1,stringBufLen,fp);
         }
     return false;
     }
@@ -261,19 +971,20 @@ bool dictionary::readLeaves(FILE * fp)
     {
     tcount leafBufLen;
     int readcount = 0;
-    if(fread(&leafBufLen,sizeof(leafBufLen),1,fp) == 1)
+    if(readOld(&leafBufLen,sizeof(leafBufLen),fp))
         {
         LEXT = new lext[leafBufLen];
+        NLEXT = leafBufLen;
         for(tcount i = 0;i < leafBufLen;++i)
             {
             tindex tmp;
-            if(fread(&tmp,sizeof(tmp),1,fp) == 1)
+            if(readOld(&tmp,sizeof(tmp),fp))
                 {
-                LEXT[i].Type = tmp + STRINGS;
-                if(fread(&tmp,sizeof(tmp),1,fp) == 1)
+                LEXT[i].iType = tmp;
+                if(readOld(&tmp,sizeof(tmp),fp))
                     {
-                    LEXT[i].BaseFormSuffix = tmp + STRINGS;
-                    if(fread(&LEXT[i].S,sizeof(LEXT[i].S),1,fp) == 1)
+                    LEXT[i].iBaseFormSuffix = tmp;
+                    if(readOld(&LEXT[i].S,sizeof(LEXT[i].S),fp))
                         {
                         ++readcount;
                         }
@@ -303,12 +1014,12 @@ tcount dictionary::readStretch(tchildren length,tcount pos,FILE * fp)
     for(i = 0;i < length;++i)
         {
         tindex tmp;
-        if(  fread(&tmp,sizeof(tmp),1,fp) != 1
-          || fread(&NODES.numberOfChildren[pos + i],sizeof(NODES.numberOfChildren[pos + i]),1,fp) != 1
-          || fread(&NODES.pos[pos + i],sizeof(NODES.pos[pos + i]),1,fp) != 1
+        if(  !readOld(&tmp,sizeof(tmp),fp)
+          || !readOld(&NODES.numberOfChildren[pos + i],sizeof(NODES.numberOfChildren[pos + i]),fp)
+          || !readOld(&NODES.pos[pos + i],sizeof(NODES.pos[pos + i]),fp)
           )
             return 0; // error!
-        NODES.strings[pos + i] = STRINGS + tmp;
+        NODES.strings[pos + i] = tmp;
         }
     tcount curr = pos + length;
     for(i = 0;i < length;++i)
@@ -325,46 +1036,311 @@ tcount dictionary::readStretch(tchildren length,tcount pos,FILE * fp)
 bool dictionary::readNodes(FILE * fp)
     {
     tcount nodeBufLen;
-    if(fread(&nodeBufLen,sizeof(nodeBufLen),1,fp) == 1)
+    if(readOld(&nodeBufLen,sizeof(nodeBufLen),fp))
         {
         NODES.nnodes = nodeBufLen;
-        NODES.initialchars = new int[nodeBufLen];
-        NODES.strings = new char * [nodeBufLen];
+        NODES.initialchars = new INT32[nodeBufLen];
+        NODES.strings = new tindex[nodeBufLen];
         NODES.numberOfChildren = new tchildren[nodeBufLen];
         NODES.pos = new tindex[nodeBufLen];
         tchildren length;
-        if(fread(&length,sizeof(length),1,fp) == 1)
+        if(readOld(&length,sizeof(length),fp))
             {
             NODES.ntoplevel = length;
             readStretch(NODES.ntoplevel,0,fp);
             for(tcount i = 0;i < nodeBufLen;++i)
                 {
-                NODES.initialchars[i] = UTF8char(NODES.strings[i],staticUTF8);
+                NODES.initialchars[i] = UTF8char(STRINGS + NODES.strings[i],staticUTF8);
                 }
+            indexTopLevel();
             }
         return true;
         }
     return false;
     }
 
+void dictionary::indexTopLevel()
+    {
+    for(int k = 0;k < 128;++k)
+        NODES.toplevelASCII[k] = -1;
+    for(tchildrencount i = 0;i < NODES.ntoplevel;++i)
+        {
+        int kar = NODES.initialchars[i];
+        if(0 <= kar && kar < 128 && NODES.toplevelASCII[kar] < 0)
+            NODES.toplevelASCII[kar] = i;
+        }
+    }
+
+/*
+Memory mappable dictionary (format version 2). See lem.h.
+The file is mapped (or, if mapping is not possible, read in one go) and the
+sections are used as they are.
+*/
+static char * section(const tdictheader * header,dictSection sec,size_t size)
+    {
+    const tdictsection & S = header->section[sec];
+    if(  S.offset <= 0 
+      || S.offset % DICTALIGN 
+      || S.size <= 0
+      || (size && (size_t)S.size != size)
+      || (size_t)S.offset + (size_t)S.size > IMAGESIZE
+      )
+        {
+        fprintf(stderr,"Dictionary: section %d is missing or has wrong size.\n",(int)sec);
+        return NULL;
+        }
+    return IMAGE + S.offset;
+    }
+
+bool dictionary::readImage(FILE * fp)
+    {
+    if(FSEEK(fp,0,SEEK_END) != 0)
+        { // A pipe: read on after the bytes that load() has read.
+        size_t room = 0x10000;
+        IMAGE = (char *)malloc(room);
+        IMAGESIZE = 0;
+        if(IMAGE)
+            {
+            memcpy(IMAGE,HEAD,HEADLEN);
+            IMAGESIZE = HEADLEN;
+            size_t got;
+            while((got = fread(IMAGE + IMAGESIZE,1,room - IMAGESIZE,fp)) > 0)
+                {
+                IMAGESIZE += got;
+                if(IMAGESIZE == room)
+                    {
+                    char * grown = (char *)realloc(IMAGE,2 * room);
+                    if(!grown)
+                        break;
+                    IMAGE = grown;
+                    room *= 2;
+                    }
+                }
+            }
+        if(!IMAGE || !feof(fp))
+            {
+            fprintf(stderr,"Dictionary: cannot read file.\n");
+            cleanup();
+            return false;
+            }
+        if(IMAGESIZE < sizeof(tdictheader))
+            {
+            fprintf(stderr,"Dictionary: file too short.\n");
+            cleanup();
+            return false;
+            }
+        return useImage();
+        }
+    LONG size = FTELL(fp);
+    if(size < (LONG)sizeof(tdictheader))
+        {
+        fprintf(stderr,"Dictionary: file too short.\n");
+        return false;
+        }
+    IMAGESIZE = (size_t)size;
+#if !defined _WIN32
+    IMAGE = (char *)mmap(NULL,IMAGESIZE,PROT_READ,MAP_PRIVATE,fileno(fp),0);
+    if(IMAGE == MAP_FAILED)
+        IMAGE = NULL;
+    else
+        IMAGEMAPPED = true;
+#endif
+    if(!IMAGE)
+        { // malloc returns memory that is aligned for any type.
+        IMAGE = (char *)malloc(IMAGESIZE);
+        rewind(fp);
+        if(!IMAGE || fread(IMAGE,IMAGESIZE,1,fp) != 1)
+            {
+            fprintf(stderr,"Dictionary: cannot read file.\n");
+            cleanup();
+            return false;
+            }
+        }
+    return useImage();
+    }
+
+/* Use a memory mappable dictionary that is already in memory, aligned for
+   any type. The image is not copied and must outlive the dictionary. */
+bool dictionary::readImage(const char * image,size_t size)
+    {
+    if(size < sizeof(tdictheader) || memcmp(image,DICTMAGIC,sizeof(DICTMAGIC) - 1))
+        {
+        fprintf(stderr,"Dictionary: not a memory mappable dictionary.\n");
+        return false;
+        }
+    IMAGE = (char *)image;
+    IMAGESIZE = size;
+    IMAGEBORROWED = true;
+    return useImage();
+    }
+
+/* Point STRINGS, LEXT, NODES etc. at the sections of IMAGE. */
+bool dictionary::useImage()
+    {
+    const tdictheader * header = (const tdictheader *)IMAGE;
+    if(  header->version != DICTVERSION
+      || header->byteorder != DICTBYTEORDER
+      || header->sizeofindex != sizeof(tindex)
+      || header->sizeoflext != sizeof(lext)
+      )
+        {
+        fprintf(stderr,"Dictionary: format version %d is not supported by this program.\n",(int)header->version);
+        cleanup();
+        return false;
+        }
+    size_t nnodes = (size_t)header->nnodes;
+    STRINGS = section(header,DS_STRINGS,0);
+    NSTRINGS = (size_t)header->section[DS_STRINGS].size;
+    LEXT = (lext *)section(header,DS_LEXT,(size_t)header->nlext * sizeof(lext));
+    NODES.initialchars = (INT32 *)section(header,DS_INITIALCHARS,nnodes * sizeof(INT32));
+    NODES.strings = (tindex *)section(header,DS_NODESTRINGS,nnodes * sizeof(tindex));
+    NODES.pos = (tindex *)section(header,DS_POS,nnodes * sizeof(tindex));
+    NODES.numberOfChildren = (tchildren *)section(header,DS_NUMBEROFCHILDREN,nnodes * sizeof(tchildren));
+    if(  !STRINGS 
+      || !LEXT 
+      || !NODES.initialchars 
+      || !NODES.strings 
+      || !NODES.pos 
+      || !NODES.numberOfChildren
+      )
+        {
+        cleanup();
+        return false;
+        }
+    if(header->section[DS_DABASE].size > 0)
+        {
+        size_t dasize = (size_t)header->section[DS_DABASE].size;
+        DABASE = (INT32 *)section(header,DS_DABASE,dasize);
+        DACHECK = (INT32 *)section(header,DS_DACHECK,dasize);
+        if(!DABASE || !DACHECK)
+            {
+            cleanup();
+            return false;
+            }
+        DASIZE = (INT32)(dasize / sizeof(INT32));
+        }
+    if(header->section[DS_BLOOM].size > 0)
+        {
+        size_t bloomsize = (size_t)header->section[DS_BLOOM].size;
+        const char * bloom = section(header,DS_BLOOM,bloomsize);
+        if(bloom)
+            {
+            FILTER = new bloomfilter(bloom,bloomsize);
+            if(!FILTER->valid())
+                {
+                fprintf(stderr,"Dictionary: Bloom filter ignored.\n");
+                delete FILTER;
+                FILTER = NULL;
+                }
+            }
+        }
+    if(header->section[DS_TYPES].size > 0)
+        {
+        NTYPES = header->section[DS_TYPES].size / (tcount)sizeof(tindex);
+        TYPES = (const tindex *)section(header,DS_TYPES,NTYPES * sizeof(tindex));
+        if(!TYPES)
+            NTYPES = 0;
+        }
+    NLEXT = header->nlext;
+    if(header->section[DS_FCSTRINGS].size > 0)
+        {
+        size_t fcsize = (size_t)header->section[DS_FCSTRINGS].size;
+        const char * fc = section(header,DS_FCSTRINGS,fcsize);
+        const tfcheader * fcheader = (const tfcheader *)fc;
+        if(  !fc
+          || fcsize < sizeof(tfcheader)
+          || fcheader->blocksize <= 0
+          || fcheader->nstrings < 0
+          || ((size_t)fcheader->nstrings + fcheader->blocksize - 1) / fcheader->blocksize > (fcsize - sizeof(tfcheader)) / sizeof(INT32)
+          )
+            {
+            if(fc)
+                fprintf(stderr,"Dictionary: front coded strings are corrupt.\n");
+            cleanup();
+            return false;
+            }
+        FCBLOCK = fcheader->blocksize;
+        FCOFFSETS = (const INT32 *)(fc + sizeof(tfcheader));
+        FCDATA = (const char *)(FCOFFSETS + (fcheader->nstrings + FCBLOCK - 1) / FCBLOCK);
+        if(!validFrontCoded(fcheader->nstrings,fc + fcsize,nnodes))
+            {
+            fprintf(stderr,"Dictionary: front coded strings are corrupt.\n");
+            cleanup();
+            return false;
+            }
+        }
+    if(header->section[DS_LEAFINFO].size > 0)
+        LEAFINFO = (const tleafinfo *)section(header,DS_LEAFINFO,(size_t)header->nlext * sizeof(tleafinfo));
+    STRINGS1 = STRINGS + 1;
+    lext::Strings = STRINGS;
+    NODES.nnodes = header->nnodes;
+    NODES.ntoplevel = header->ntoplevel;
+    staticUTF8 = header->utf8 != 0;
+    indexTopLevel();
+    return true;
+    }
+
 void dictionary::cleanup()
     {
-    delete [] STRINGS;
-    delete [] LEXT;
-    delete [] NODES.initialchars;
-    delete [] NODES.strings;
-    delete [] NODES.numberOfChildren;
-    delete [] NODES.pos;
+    delete FILTER;
+    FILTER = NULL;
+    if(IMAGE)
+        {
+        if(IMAGEBORROWED)
+            ;
+#if !defined _WIN32
+        else if(IMAGEMAPPED)
+            munmap(IMAGE,IMAGESIZE);
+#endif
+        else
+            free(IMAGE);
+        IMAGE = NULL;
+        IMAGESIZE = 0;
+        IMAGEMAPPED = false;
+        IMAGEBORROWED = false;
+        }
+    else
+        {
+        delete [] STRINGS;
+        delete [] LEXT;
+        delete [] NODES.initialchars;
+        delete [] NODES.strings;
+        delete [] NODES.numberOfChildren;
+        delete [] NODES.pos;
+        }
+    STRINGS = NULL;
+    STRINGS1 = NULL;
+    NSTRINGS = 0;
+    LEXT = NULL;
+    NODES.initialchars = NULL;
+    NODES.strings = NULL;
+    NODES.numberOfChildren = NULL;
+    NODES.pos = NULL;
+    DABASE = NULL;
+    DACHECK = NULL;
+    DASIZE = 0;
+    LEAFINFO = NULL;
+    FCOFFSETS = NULL;
+    FCDATA = NULL;
+    FCBLOCK = 0;
+    TYPES = NULL;
+    NTYPES = 0;
+    NLEXT = 0;
+    NODES.nnodes = 0;
+    NODES.ntoplevel = 0;
+    for(int k = 0;k < 128;++k)
+        NODES.toplevelASCII[k] = -1;
+    lext::Strings = EMPTY;
     }
 
 void dictionary::printlex(tindex pos, FILE * fp)
     {
-    fprintf(fp,"%s %s %d %d",LEXT[pos].BaseFormSuffix,LEXT[pos].Type,LEXT[pos].S.Offset,LEXT[pos].S.frequency);
+    fprintf(fp,"%s %s %d %d",LEXT[pos].BaseFormSuffix(),LEXT[pos].Type(),LEXT[pos].S.Offset,LEXT[pos].S.frequency);
     }
 
 void dictionary::printlex2(char * head,tindex pos, FILE * fp)
     {
-    fprintf(fp,"%.*s%s/%s %d",(int)LEXT[pos].S.Offset,head,LEXT[pos].BaseFormSuffix,LEXT[pos].Type,LEXT[pos].S.frequency);
+    fprintf(fp,"%.*s%s/%s %d",(int)LEXT[pos].S.Offset,head,LEXT[pos].BaseFormSuffix(),LEXT[pos].Type(),LEXT[pos].S.frequency);
     }
 
 void dictionary::printnode(size_t indent, tindex pos, FILE * fp)
@@ -373,7 +1349,8 @@ void dictionary::printnode(size_t indent, tindex pos, FILE * fp)
     tchildrencount i;
     for(size_t j = indent;j;--j)
         fputc(' ',fp);
-    fprintf(fp,"%s",NODES.strings[pos]);
+    char buf[DICTFCMAXSTRING];
+    fprintf(fp,"%s",nodeString(pos,buf));
     if(NODES.pos[pos] < 0)
         {
         fprintf(fp,"\n");
@@ -398,7 +1375,8 @@ void dictionary::printnode(size_t indent, tindex pos, FILE * fp)
 void dictionary::printnode2(char * head, tindex pos, FILE * fp)
     {
     size_t len = strlen(head);
-    strcpy(head+len,NODES.strings[pos]);
+    char buf[DICTFCMAXSTRING];
+    strcpy(head+len,nodeString(pos,buf));
     tchildren n = NODES.numberOfChildren[pos];
     tchildrencount i;
     if(NODES.pos[pos] < 0)
@@ -421,4 +1399,249 @@ void dictionary::printnode2(char * head, tindex pos, FILE * fp)
         }
     head[len] = '\0';
     }
+
+/*
+Delta dictionary. A text file with one reading per line:
+
+    full form TAB type TAB lemma [TAB frequency]
+
+The readings of a full form in the delta are added to the readings of that
+full form in the dictionary, or are its only readings if the dictionary does
+not have the full form. Look-ups consult the delta before the dictionary.
+Call setDelta before initdict or initdictAsync.
+*/
+bool dictionary::setDelta(FILE * fp)
+    {
+    clearDelta();
+    DELTAREADINGS = new std::vector<deltaReading>;
+    std::string line;
+    int kar;
+    int lineno = 0;
+    do
+        {
+        kar = getc(fp);
+        if(kar != '\n' && kar != EOF)
+            {
+            if(kar != '\r')
+                line += (char)kar;
+            continue;
+            }
+        ++lineno;
+        if(line.empty())
+            continue;
+        std::string field[4];
+        int nfield = 0;
+        size_t start = 0;
+        for(;nfield < 4;++nfield)
+            {
+            size_t tab = line.find('\t',start);
+            field[nfield] = line.substr(start,tab == std::string::npos ? tab : tab - start);
+            if(tab == std::string::npos)
+                {
+                ++nfield;
+                break;
+                }
+            start = tab + 1;
+            }
+        if(nfield < 3 || field[0].empty() || field[1].empty() || field[2].empty())
+            fprintf(stderr,"Delta dictionary line %d: expected full form, type and lemma separated by tabs\n",lineno);
+        else
+            {
+            deltaReading reading;
+            reading.fullform = field[0];
+            reading.type = field[1];
+            reading.lemma = field[2];
+            reading.frequency = nfield > 3 ? (unsigned int)strtoul(field[3].c_str(),NULL,10) : 0;
+            DELTAREADINGS->push_back(reading);
+            }
+        line.clear();
+        }
+    while(kar != EOF);
+    return !DELTAREADINGS->empty();
+    }
+
+static bool fullformLess(const deltaReading & a,const deltaReading & b)
+    {
+    return a.fullform < b.fullform;
+    }
+
+/* Build the look-up structures of the delta, after the dictionary is loaded. */
+void dictionary::applyDelta()
+    {
+    if(!DELTAREADINGS)
+        return;
+    std::vector<deltaReading> & readings = *DELTAREADINGS;
+    std::stable_sort(readings.begin(),readings.end(),fullformLess);
+    std::string forms;
+    std::string strings; // appended to STRINGS
+    std::map<std::string,tindex> pooled;
+    std::vector<lext> lexts;
+    std::vector<tdeltaentry> entries;
+    for(size_t r = 0;r < readings.size();)
+        {
+        const std::string & fullform = readings[r].fullform;
+        tdeltaentry entry;
+        entry.fullform = (tindex)forms.size();
+        entry.first = (tcount)lexts.size();
+        walkState start = {0,0,(int)NODES.ntoplevel,0};
+        tcount pos;
+        int nmbr;
+        if(DABASE ? findLeafDA(fullform.c_str(),start,-1,NULL,pos,nmbr) : findLeaf(fullform.c_str(),start,-1,NULL,pos,nmbr))
+            lexts.insert(lexts.end(),LEXT + pos,LEXT + pos + nmbr);
+        entry.nmain = (int)(lexts.size() - entry.first);
+        for(;r < readings.size() && readings[r].fullform == fullform;++r)
+            {
+            const char * lemma = readings[r].lemma.c_str();
+            ptrdiff_t i,j;
+            strcmpN(lemma,fullform.c_str(),i,j);
+            if(i > 255)
+                {
+                fprintf(stderr,"Delta dictionary: lemma %s of %s has too long a common prefix\n",lemma,fullform.c_str());
+                continue;
+                }
+            tindex strs[2];
+            const char * str[2] = {readings[r].type.c_str(),lemma + i};
+            for(int k = 0;k < 2;++k)
+                {
+                strs[k] = k == 0 ? tagregistry::dictType(str[0]) : str[1][0] ? -1 : 0;
+                if(strs[k] < 0)
+                    {
+                    std::map<std::string,tindex>::iterator it = pooled.find(str[k]);
+                    if(it == pooled.end())
+                        {
+                        strs[k] = (tindex)(NSTRINGS + strings.size());
+                        strings += str[k];
+                        strings += '\0';
+                        pooled[str[k]] = strs[k];
+                        }
+                    else
+                        strs[k] = it->second;
+                    }
+                }
+            if(tagregistry::dictType(str[0]) < 0)
+                tagregistry::setDictType(tagregistry::add(str[0]),strs[0]);
+            bool duplicate = false;
+            for(size_t k = entry.first;k < lexts.size() && !duplicate;++k)
+                {
+                tindex suffix = lexts[k].iBaseFormSuffix;
+                duplicate = lexts[k].iType == strs[0]
+                         && lexts[k].S.Offset == (unsigned int)i
+                         && !strcmp(suffix < (tindex)NSTRINGS ? STRINGS + suffix : strings.c_str() + (suffix - NSTRINGS),str[1]);
+                }
+            if(duplicate)
+                continue;
+            lext reading;
+            reading.iType = strs[0];
+            reading.iBaseFormSuffix = strs[1];
+            reading.S.Offset = (unsigned int)i;
+            reading.S.frequency = readings[r].frequency > 0xFFFFFF ? 0xFFFFFF : readings[r].frequency;
+            lexts.push_back(reading);
+            }
+        entry.n = (int)(lexts.size() - entry.first);
+        if(entry.n > 0)
+            {
+            forms += fullform;
+            forms += '\0';
+            entries.push_back(entry);
+            }
+        }
+    delete DELTAREADINGS;
+    DELTAREADINGS = NULL;
+    if(entries.empty())
+        return;
+
+    DELTASTRINGS = new char[NSTRINGS + strings.size()];
+    memcpy(DELTASTRINGS,STRINGS,NSTRINGS);
+    memcpy(DELTASTRINGS + NSTRINGS,strings.data(),strings.size());
+    lext::Strings = DELTASTRINGS;
+    DELTAFORMS = new char[forms.size()];
+    memcpy(DELTAFORMS,forms.data(),forms.size());
+    DELTALEXT = new lext[lexts.size()];
+    std::copy(lexts.begin(),lexts.end(),DELTALEXT);
+    NDELTAENTRIES = (tcount)entries.size();
+    DELTAENTRIES = new tdeltaentry[NDELTAENTRIES];
+    std::copy(entries.begin(),entries.end(),DELTAENTRIES);
+    for(DELTANSLOTS = 16;DELTANSLOTS < 2 * NDELTAENTRIES;DELTANSLOTS <<= 1)
+        ;
+    DELTASLOTS = new INT32[DELTANSLOTS];
+    memset(DELTASLOTS,0,DELTANSLOTS * sizeof(INT32));
+    for(tcount e = 0;e < NDELTAENTRIES;++e)
+        {
+        INT32 i = deltaHash(DELTAFORMS + DELTAENTRIES[e].fullform) & (DELTANSLOTS - 1);
+        while(DELTASLOTS[i])
+            i = (i + 1) & (DELTANSLOTS - 1);
+        DELTASLOTS[i] = e + 1;
+        }
+    DELTASIZE = NSTRINGS + strings.size()
+              + forms.size()
+              + lexts.size() * sizeof(lext)
+              + NDELTAENTRIES * sizeof(tdeltaentry)
+              + DELTANSLOTS * sizeof(INT32);
+    }
+
+void dictionary::clearDelta()
+    {
+    delete DELTAREADINGS;
+    DELTAREADINGS = NULL;
+    delete [] DELTASLOTS;
+    DELTASLOTS = NULL;
+    DELTANSLOTS = 0;
+    delete [] DELTAENTRIES;
+    DELTAENTRIES = NULL;
+    NDELTAENTRIES = 0;
+    delete [] DELTAFORMS;
+    DELTAFORMS = NULL;
+    delete [] DELTALEXT;
+    DELTALEXT = NULL;
+    if(lext::Strings == DELTASTRINGS)
+        lext::Strings = STRINGS ? STRINGS : EMPTY;
+    delete [] DELTASTRINGS;
+    DELTASTRINGS = NULL;
+    DELTASIZE = 0;
+    }
+
+static void dumpReading(const char * fullform,const lext * plext,FILE * lexicon,FILE * frequencies)
+    {
+    fprintf(lexicon,"%s\t%.*s%s\t%s\n",fullform,(int)plext->S.Offset,fullform,plext->BaseFormSuffix(),plext->Type());
+    if(plext->S.frequency > 0)
+        fprintf(frequencies,"%u\t%s\t%.*s%s\t%s\n",(unsigned int)plext->S.frequency,fullform,(int)plext->S.Offset,fullform,plext->BaseFormSuffix(),plext->Type());
+    }
+
+static void dumpNode(std::string & head,tindex pos,FILE * lexicon,FILE * frequencies)
+    {
+    size_t len = head.size();
+    char buf[DICTFCMAXSTRING];
+    head += nodeString(pos,buf);
+    tchildren n = NODES.numberOfChildren[pos];
+    tchildrencount i;
+    if(NODES.pos[pos] < 0)
+        {
+        for(i = 0;i < n;++i)
+            dumpNode(head,i - NODES.pos[pos],lexicon,frequencies);
+        }
+    else
+        {
+        for(i = 0;i < n;++i)
+            dumpReading(head.c_str(),LEXT + NODES.pos[pos] + i,lexicon,frequencies);
+        }
+    head.resize(len);
+    }
+
+/*
+Write the readings of the dictionary and of the delta dictionary as a
+lexicon (format FBT) and a frequency file (format NFBT), from which makedict
+makes a dictionary that has the delta folded in.
+*/
+void dictionary::dump(FILE * lexicon,FILE * frequencies)
+    {
+    std::string head;
+    for(tcount i = 0;i < NODES.ntoplevel;++i)
+        dumpNode(head,i,lexicon,frequencies);
+    for(tcount e = 0;e < NDELTAENTRIES;++e)
+        {
+        const tdeltaentry & entry = DELTAENTRIES[e];
+        for(int k = entry.nmain;k < entry.n;++k)
+            dumpReading(DELTAFORMS + entry.fullform,DELTALEXT + entry.first + k,lexicon,frequencies);
+        }
+    }
 #endif
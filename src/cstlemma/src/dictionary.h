@@ -26,9 +26,33 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if defined PROGLEMMATISE
 #include "lext.h"
 #include <stdio.h>
+#include <stddef.h>
 
 extern lext * LEXT;
 
+/* Where a walk through the dictionary is: done bytes of the word matched,
+   and the stretch of candidate nodes (or the double-array state) to
+   continue from. */
+struct walkState
+    {
+    ptrdiff_t done;
+    tcount stretch;
+    int length;
+    INT32 state;
+    };
+
+/* Memory taken by the dictionary, in bytes. See dictionary::memory */
+struct tdictmemory
+    {
+    size_t strings;  // string pool and front coded node strings
+    size_t readings; // lext records, precomputed leaf info and types
+    size_t nodes;    // initialchars, strings, numberOfChildren and pos
+    size_t trie;     // double-array trie
+    size_t filter;   // Bloom filter
+    size_t delta;    // delta dictionary, including its copy of the strings
+    bool mapped;     // dictionary file is memory mapped (pages are shared)
+    };
+
 class dictionary
     {
 #ifdef COUNTOBJECTS
@@ -40,16 +64,43 @@ class dictionary
         static bool readLeaves(FILE * fp);
         static tcount readStretch(tchildren length,tcount pos,FILE * fp);
         static bool readNodes(FILE * fp);
+        static bool readImage(FILE * fp);
+        static bool readImage(const char * image,size_t size);
+        static bool useImage();
+        static void makeFilter(double BloomRate);
+        static void indexTopLevel();
+        static void registerTypes();
+        static bool load(FILE * fpin,double BloomRate);
+        static void backgroundLoad(FILE * fpin,double BloomRate);
+        static void finishLoading();
         static void cleanup();
         
         static void printlex(tindex pos, FILE * fp);
         static void printlex2(char * head,tindex pos, FILE * fp);
         static void printnode(size_t indent, tindex pos, FILE * fp);
         static void printnode2(char * head,tindex pos, FILE * fp);
-        static bool findwordSub(const char * word, const char * tag, tcount & Pos,int & Nmbr);
+        static void applyDelta();
+        static void clearDelta();
+        static int findDelta(const char * word, const char * tag, lext *& Plext,int & Nmbr);
+        static bool findwordSub(const char * word, const char * tag, const walkState & at, ptrdiff_t shared, walkState * fork, lext *& Plext,int & Nmbr);
     public:
-        static bool findword(const char * word,const char * tag,tcount & Pos,int & Nmbr);
-        bool initdict(FILE * fpin);
+        static bool findword(const char * word,const char * tag,lext *& Plext,int & Nmbr);
+        static void beginBatch(const char * const * words,size_t n);
+        static void batchWord(size_t i);
+        static void endBatch();
+        static bool setDelta(FILE * fp);
+        static void dump(FILE * lexicon,FILE * frequencies);
+        bool initdict(FILE * fpin,double BloomRate);
+        bool initdict(const char * image,size_t size,double BloomRate);
+        void initdictAsync(FILE * fpin,double BloomRate);
+        void close();
+        static bool poll();
+        static bool waitUntilReady();
+        static bool loading();
+        static bool filterStatistics(unsigned long & probes,unsigned long & rejects);
+        static void addFilterStatistics(unsigned long probes,unsigned long rejects);
+        static bool memory(tdictmemory & mem);
+        static const tleafinfo * leafInfo(const lext * plext);
         dictionary();
         ~dictionary();
         void printall(FILE * fp);
@@ -26,11 +26,21 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "field.h"
 #include "caseconv.h"
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <ctype.h>
 
 #include <string>
 
+/* Runs of bytes that don't end a token are skipped 16 at a time with SSE2
+   (see flatinput::skip), otherwise one at a time. */
+#if defined __SSE2__ && (defined __GNUC__ || defined __clang__)
+#define FLATSSE2 1
+#include <emmintrin.h>
+#else
+#define FLATSSE2 0
+#endif
+
 using namespace std;
 
 static int sanityCheck(int slashFound, const char *buf)
@@ -51,43 +61,175 @@ static int sanityCheck(int slashFound, const char *buf)
     return slashFound;
 }
 
-static bool spaces(int kar, FILE *fp, unsigned long &newlines, int &eof, int &prevkar)
+#define FLATINPUTBLOCK 0x10000 // bytes read at a time
+
+/* Byte classes for getword. A token can only end at a byte of one of these
+   classes. */
+#define CC_SPACE 1 // isSpace
+#define CC_SLASH 2 // word/tag, alternatives
+#define CC_PUNCT 4 // split off if keepPunctuation != 1
+static unsigned char charclass[256];
+static const bool *classified = 0; // the space[] that charclass was set up for
+
+/* Set up charclass. space[] depends on the encoding (-e), so charclass is
+   set up again only if the encoding has changed since the last time. */
+static void classify()
 {
-    if (isSpace(kar))
+    if (classified == space)
+        return;
+    classified = space;
+    for (int kar = 0; kar < 256; ++kar)
     {
-        if (kar == '\n')
-        {
-            ++newlines;
-        }
-        // We need to look for new line after the blank. If we wait, the first
-        // word of the next line will become the last word of the current line.
-        // If there is no new line character, the first character of the next
-        // word will be read. Put this in a safe place: prevkar.
-        else
-        {
-            do
-            {
-                kar = fgetc(fp);
-                if (kar == EOF)
+        charclass[kar] = 0;
+        if (isSpace(kar))
+            charclass[kar] |= CC_SPACE;
+        if (kar == '/')
+            charclass[kar] |= CC_SLASH;
+        if (ispunct(kar) && kar != '-' /*gr-det-selv*/ && kar != '\'' /*bli'r*/)
+            charclass[kar] |= CC_PUNCT;
+    }
+}
 
-                {
-                    eof = true;
-                    break;
-                }
-            } while (isSpace(kar) && kar != '\n');
-            if (kar == '\n')
-            {
-                ++newlines;
-            }
-            else if (!eof)
-                prevkar = kar;
+/* The input of getword and getwordI: a window on a file, which is read in
+   blocks, or on a string. getword returns its tokens as pointers into the
+   window, terminated in place, so that a token isn't copied and can have any
+   length. The window is kept from the start of the current token on. The
+   byte after the window is always nul. */
+class flatinput
+{
+private:
+    FILE *fp;   // 0 if reading a string
+    char *buf;
+    size_t size; // of buf, not counting the nul byte after it
+    size_t mark; // start of the current token
+    size_t pos;
+    size_t end;
+    int fill();
+
+public:
+    int punct; // split off from the previous token, returned next
+    bool eof;  // at end of input, to be returned after the current token
+    flatinput() : fp(0), buf(0), size(0), mark(0), pos(0), end(0), punct(0), eof(false)
+    {
+    }
+    ~flatinput()
+    {
+        close();
+    }
+    void open(FILE *a_fp)
+    {
+        close();
+        classify();
+        fp = a_fp;
+    }
+    void open(char *str, size_t length) // str[length] must be nul
+    {
+        close();
+        classify();
+        buf = str;
+        size = end = length;
+    }
+    void close()
+    {
+        if (fp)
+            delete[] buf;
+        fp = 0;
+        buf = 0;
+        size = mark = pos = end = 0;
+        punct = 0;
+        eof = false;
+    }
+    bool isOpen(FILE *a_fp) const
+    {
+        return fp && fp == a_fp;
+    }
+    int get()
+    {
+        return pos < end ? (unsigned char)buf[pos++] : fill();
+    }
+    void unget()
+    {
+        --pos;
+    }
+    void skip(unsigned char stop);
+    void begin()
+    {
+        mark = pos;
+    }
+    size_t offset() const // from the start of the current token
+    {
+        return pos - mark;
+    }
+    char *token()
+    {
+        return buf + mark;
+    }
+};
+
+/* Read the next block. The current token is moved to the start of the
+   window, which is grown if the token fills it. */
+int flatinput::fill()
+{
+    if (!fp)
+        return EOF;
+    if (mark > 0)
+    {
+        memmove(buf, buf + mark, end - mark);
+        pos -= mark;
+        end -= mark;
+        mark = 0;
+    }
+    if (end == size)
+    {
+        size_t grown = size ? 2 * size : FLATINPUTBLOCK;
+        char *b = new char[grown + 1];
+        if (end)
+            memcpy(b, buf, end);
+        delete[] buf;
+        buf = b;
+        size = grown;
+    }
+    end += fread(buf + end, 1, size - end, fp);
+    buf[end] = '\0';
+    return pos < end ? (unsigned char)buf[pos++] : EOF;
+}
+
+/* Move on to the first byte in the window that is in one of the classes in
+   stop, or to the end of the window. */
+void flatinput::skip(unsigned char stop)
+{
+#if FLATSSE2
+    // Candidates: 0x00-0x2F, 0x3A-0x40, 0x5B-0x60, 0x7B-0x7F and 0xA0, which
+    // are all the bytes that can be in a class, and some more (controls, DEL).
+    while (end - pos >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + pos));
+        __m128i ascii = _mm_cmpgt_epi8(v, _mm_set1_epi8(-1));
+        __m128i low = _mm_and_si128(ascii, _mm_cmplt_epi8(v, _mm_set1_epi8(0x41)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x2F)), _mm_cmplt_epi8(v, _mm_set1_epi8(0x3A)));
+        __m128i between = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x5A)), _mm_cmplt_epi8(v, _mm_set1_epi8(0x61)));
+        __m128i high = _mm_cmpgt_epi8(v, _mm_set1_epi8(0x7A));
+        __m128i nbsp = _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xA0));
+        __m128i candidate = _mm_or_si128(_mm_or_si128(_mm_andnot_si128(digit, low), between), _mm_or_si128(high, nbsp));
+        int mask = _mm_movemask_epi8(candidate);
+        if (mask == 0)
+        {
+            pos += 16;
+            continue;
         }
-        return true;
+        pos += __builtin_ctz(mask);
+        if (charclass[(unsigned char)buf[pos]] & stop)
+            return;
+        ++pos;
     }
-    return false;
+#endif
+    while (pos < end && !(charclass[(unsigned char)buf[pos]] & stop))
+        ++pos;
 }
 
-static bool spaces(int kar, string str, string::size_type &i, unsigned long &newlines, int &eof, int &prevkar)
+static flatinput input; // kept from chunk to chunk (see flattext.h)
+
+static bool spaces(int kar, flatinput &in, unsigned long &newlines)
 {
     if (isSpace(kar))
     {
@@ -95,15 +237,18 @@ static bool spaces(int kar, string str, string::size_type &i, unsigned long &new
         {
             ++newlines;
         }
+        // We need to look for new line after the blank. If we wait, the first
+        // word of the next line will become the last word of the current line.
+        // If there is no new line character, the first character of the next
+        // word will be read. Put it back.
         else
         {
             do
             {
-                i++;
-                kar = str[i];
+                kar = in.get();
                 if (kar == EOF)
                 {
-                    eof = true;
+                    in.eof = true;
                     break;
                 }
             } while (isSpace(kar) && kar != '\n');
@@ -111,202 +256,127 @@ static bool spaces(int kar, string str, string::size_type &i, unsigned long &new
             {
                 ++newlines;
             }
-            else if (!eof)
-                prevkar = kar;
+            else if (!in.eof)
+                in.unget();
         }
         return true;
     }
     return false;
 }
 
-static char *getword(FILE *fp, const char *&tag, bool InputHasTags, int keepPunctuation, int &slashFound, unsigned long &newlines)
+/* What getwordI has read ahead, but not yet returned. Like input, it is
+   kept from chunk to chunk (-S). flattext::restart() forgets both. */
+static int fileLastkar = '\0';
+
+void flattext::restart()
+{
+    input.close();
+    fileLastkar = '\0';
+}
+
+static char *getword(flatinput &in, const char *&tag, bool InputHasTags, int keepPunctuation, int &slashFound, unsigned long &newlines)
 // newlines is incremented when the current word is followed by a new line \n
 {
-    static int punct = 0;
-    static char buf[1000];
-    static char buf2[256]; // tag
-    static int eof = false;
-    static int prevkar = 0;
+    static char punct[2];
     newlines = 0;
     slashFound = 0;
-    if (punct)
+    if (in.punct)
     {
-        buf[0] = (char)punct;
-        buf[1] = '\0';
-        punct = 0;
-        return buf;
+        punct[0] = (char)in.punct;
+        punct[1] = '\0';
+        in.punct = 0;
+        return punct;
     }
-    int kar;
-    char *p;
-    p = buf;
     tag = 0;
-    if (eof)
+    if (in.eof)
     {
-        eof = false;
+        in.close();
         return 0;
     }
+    int kar;
+    size_t length = 0;   // of the word
+    size_t tagstart = 0; // 0: no tag
+    size_t tagend = 0;
+    unsigned char stop = CC_SPACE | CC_SLASH; // the bytes that need a closer look
+    if (!InputHasTags && keepPunctuation != 1)
+        stop |= CC_PUNCT;
+    in.begin();
     for (;;)
     {
-        if (prevkar)
-        {
-            kar = prevkar;
-            prevkar = 0;
-        }
-        else
+        kar = in.get();
+        if (kar == EOF)
         {
-            kar = fgetc(fp);
-            if (kar == EOF)
-
-            {
-                eof = true;
-                break;
-            }
+            in.eof = true;
+            break;
         }
         if (InputHasTags)
         {
             if (kar == '/')
-            {                    // tag follows (or maybe not, see call to sanityCheck at end).
-                char *slash = p; // slash points at / in buf (the word)
-                *p = '\0';       // the / is replaced by zero
-                p = buf2;        // p points at the start of the tag buffer
-                tag = buf2;
+            {               // tag follows (or maybe not, see call to sanityCheck at end).
+                tagstart = tagend = in.offset();
                 for (;;)
                 {
-                    kar = fgetc(fp);
+                    kar = in.get();
                     if (kar == EOF)
-
                     {
-                        eof = true;
+                        in.eof = true;
                         break;
                     }
-                    if (spaces(kar, fp, newlines, eof, prevkar))
+                    if (spaces(kar, in, newlines))
                     {
                         break;
                     }
                     if (kar == '/') // oops, word contains slash
                     {
-                        ++slashFound;            // Token may need special treatment as "/"-separated alternatives.
-                        *slash = '/';            // put the slash back into the word (somewhere in buf)
-                        *p = '\0';               // prepare buf2 for being copied back to buf
-                        strcpy(slash + 1, buf2); // do the copying
-                        slash += p - buf2 + 1;   // let slash point at end of buf (the nul byte)
-                        p = buf2;                // let p start again at start of buf2
+                        ++slashFound;                // Token may need special treatment as "/"-separated alternatives.
+                        length = in.offset() - 1;    // the word runs until this slash
+                        tagstart = tagend = in.offset();
                     }
                     else
                     {
-                        if (p - buf2 == sizeof(buf2) - 1)
-                        {
-                            fprintf(stderr, "BUFFER OVERFLOW A [%s]\n", buf2);
-
-                            break;
-                        }
-                        *p++ = (char)kar;
+                        in.skip(CC_SPACE | CC_SLASH);
+                        tagend = in.offset();
                     }
                 }
                 break;
             }
         }
-        else if (keepPunctuation != 1 && p > buf && ispunct(kar) && kar != '-' /*g�r-det-selv*/
-                 && kar != '\''                                                /*bli'r*/
-        )
+        else if (keepPunctuation != 1 && length > 0 && (charclass[kar] & CC_PUNCT))
         {
             if (keepPunctuation != 0)
-                punct = kar;
+                in.punct = kar;
             break;
         }
-        if (spaces(kar, fp, newlines, eof, prevkar))
+        if (spaces(kar, in, newlines))
             break;
-        if (p - buf == sizeof(buf) - 1)
-        {
-            fprintf(stderr, "BUFFER OVERFLOW B [%s]\n", buf);
-
-            break; // overflow?
-        }
         if (kar == '/')
             ++slashFound;
-        *p++ = (char)kar;
-    }
-    *p = '\0';
-    slashFound = sanityCheck(slashFound, buf);
-    return buf;
-}
-
-static char *getword(string str, string::size_type &pos, const char *&tag, int keepPunctuation, int &slashFound, unsigned long &newlines)
-// newlines is incremented when the current word is followed by a new line \n
-{
-    static int punct = 0;
-    static char buf[1000];
-    static int eof = false;
-    static int prevkar = 0;
-
-    newlines = 0;
-    slashFound = 0;
-    if (punct)
-    {
-        buf[0] = (char)punct;
-        buf[1] = '\0';
-        punct = 0;
-        return buf;
-    }
-    int kar;
-    char *p;
-    p = buf;
-    tag = 0;
-    if (eof)
-    {
-        eof = false;
-        return 0;
+        in.skip(stop);
+        length = in.offset();
     }
-    
-    for (; pos < str.size(); pos++)
+    // The bytes at length and tagend have been read, or are the nul after the
+    // input, which is left alone: a string's may not be written.
+    char *w = in.token();
+    if (w[length])
+        w[length] = '\0';
+    if (tagstart)
     {
-        if (prevkar)
-        {
-            kar = prevkar;
-            prevkar = 0;
-        }
-        else
-        {
-            kar = str[pos];
-            if (kar == EOF)
-            {
-                eof = true;
-                break;
-            }
-        }
-        if (keepPunctuation != 1 && p > buf && ispunct(kar) && kar != '-' && kar != '\'')
-        {
-            if (keepPunctuation != 0)
-                punct = kar;
-            break;
-        }
-        if (spaces(kar, str, pos, newlines, eof, prevkar))
-            break;
-        if (p - buf == sizeof(buf) - 1)
-        {
-            fprintf(stderr, "BUFFER OVERFLOW B [%s]\n", buf);
-
-            break;
-        }
-        if (kar == '/')
-            ++slashFound;
-        *p++ = (char)kar;
+        if (w[tagend])
+            w[tagend] = '\0';
+        tag = w + tagstart;
     }
-
-    *p = '\0';
-    slashFound = sanityCheck(slashFound, buf);
-    
-    return buf;
+    slashFound = sanityCheck(slashFound, w);
+    return w;
 }
 
-static char * getwordI(FILE *fpin, const char *&tag, field *format, field *wordfield, field *tagfield, unsigned long &newlines, char *Iformat)
+static char * getwordI(flatinput &in, const char *&tag, field *format, field *wordfield, field *tagfield, unsigned long &newlines, char *Iformat)
 {
     format->reset();
     assert(wordfield);
     int kar = EOF;
     char kars[2];
     kars[1] = '\0';
-    static int lastkar = '\0';
+    int &lastkar = fileLastkar;
     field *nextfield = format;
     newlines = 0;
     if (lastkar)
@@ -316,6 +386,7 @@ static char * getwordI(FILE *fpin, const char *&tag, field *format, field *wordf
             lastkar = 0;
             tag = 0;
             format->reset();
+            in.close();
             return 0;
         }
         if (lastkar == '\n')
@@ -325,9 +396,10 @@ static char * getwordI(FILE *fpin, const char *&tag, field *format, field *wordf
         nextfield->read(kars, nextfield);
     }
     int iterations = 0;
+    in.begin(); // the fields keep their own copies
     for (iterations = 0; nextfield; ++iterations)
     {
-        kar = fgetc(fpin);
+        kar = in.get();
 
         if (kar == '\n')
         {
@@ -379,7 +451,7 @@ void flattext::printUnsorted(FILE *fpo)
     REFER(fpo) // unused
     for (k = 0; k < total; ++k)
     {
-        while (k >= Lines[line] && line <= lineno)
+        while (line <= lineno && k >= Lines[line])
         {
             Word::NewLinesAfterWord++;
             ++line;
@@ -399,7 +471,7 @@ void flattext::writeUnsorted(string &str)
     REFER(fpo) // unused
     for (k = 0; k < total; ++k)
     {
-        while (k >= Lines[line] && line <= lineno)
+        while (line <= lineno && k >= Lines[line])
         {
             Word::NewLinesAfterWord++;
             ++line;
@@ -413,8 +485,9 @@ void flattext::writeUnsorted(string &str)
 }
 
 flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctuation, bool nice,
-                   unsigned long int size, bool treatSlashAsAlternativesSeparator)
-    : text(a_InputHasTags, nice)
+                   unsigned long int size, bool treatSlashAsAlternativesSeparator,
+                   unsigned long int chunk, unsigned long int newlinesBefore)
+    : text(a_InputHasTags, nice), exhausted(false), newlinesAfter(0)
 {
     StartOfLine = true;
     fields = 0;
@@ -423,11 +496,9 @@ flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctu
     field *tagfield = 0;
     field *format = 0;
     int slashFound = 0;
-    if (nice)
-        LOG1LINE("counting words");
-    lineno = 0;
     unsigned long newlines;
-        char *w;
+    unsigned long types = Word::reducedtotal;
+    char *w = 0;
     if (Iformat)
     {
         format = translateFormat(Iformat, wordfield, tagfield);
@@ -437,63 +508,18 @@ flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctu
 
             exit(0);
         }
-        while (total < size && (w = getwordI(fpi, Tag, format, wordfield, tagfield, newlines, Iformat)) != 0)
-        {
-            lineno += newlines;
-            if (*w)
-            {
-                ++total;
-                if (treatSlashAsAlternativesSeparator)
-                {
-                    total += findSlashes(w);
-                }
-            }
-        }
-    }
-    else
-    {
-        while (total < size && (w = getword(fpi, Tag, InputHasTags, keepPunctuation, slashFound, newlines)) != 0)
-        {
-            lineno += newlines;
-            if (*w)
-            {
-                ++total;
-                if (slashFound && treatSlashAsAlternativesSeparator)
-                    total += slashFound;
-            }
-        }
-    }
-    if (nice)
-    {
-        printf("... %lu words counted in %lu lines\n", total, lineno);
-
     }
-    rewind(fpi);
-
-    if (nice)
-        LOG1LINE("allocating array of pointers to words");
-    tunsorted = new const Word *[total];
-    if (nice)
-        LOG1LINE("allocating array of line offsets");
-    Lines = new unsigned long int[lineno + 1];
-    unsigned long L = lineno + 1;
-    do
-    {
-        --L;
-        Lines[L] = 0;
-    } while (L != 0);
-    if (nice)
-        LOG1LINE("...allocated array");
-
     total = 0;
     if (nice)
         LOG1LINE("reading words");
-    lineno = 0;
+    lineno = newlinesBefore; // so that they are printed before the first word
+    if (!input.isOpen(fpi))
+        input.open(fpi);
     if (InputHasTags)
     {
         if (format)
         {
-            while (total < size && (w = getwordI(fpi, Tag, format, wordfield, tagfield, newlines, Iformat)) != 0)
+            while (total < size && !full(chunk) && (w = getwordI(input, Tag, format, wordfield, tagfield, newlines, Iformat)) != 0)
             {
                 if (Tag == 0)
                 {
@@ -510,7 +536,7 @@ flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctu
         }
         else
         {
-            while (total < size && (w = getword(fpi, Tag, true, true, slashFound, newlines)) != 0)
+            while (total < size && !full(chunk) && (w = getword(input, Tag, true, true, slashFound, newlines)) != 0)
             {
                 if (*w)
                 {
@@ -531,14 +557,14 @@ flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctu
                 }
                 lineno += newlines;
             }
-            reducedtotal = Word::reducedtotal;
+            reducedtotal = Word::reducedtotal - types;
         }
     }
     else
     {
         if (format)
         {
-            while (total < size && (w = getwordI(fpi, Tag, format, wordfield, tagfield, newlines, Iformat)) != 0)
+            while (total < size && !full(chunk) && (w = getwordI(input, Tag, format, wordfield, tagfield, newlines, Iformat)) != 0)
             {
                 if (treatSlashAsAlternativesSeparator && findSlashes(w))
                     createUnTaggedAlternatives(w);
@@ -550,7 +576,7 @@ flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctu
         }
         else
         {
-            while (total < size && (w = getword(fpi, Tag, false, keepPunctuation, slashFound, newlines)) != 0)
+            while (total < size && !full(chunk) && (w = getword(input, Tag, false, keepPunctuation, slashFound, newlines)) != 0)
             {
                 if (slashFound && treatSlashAsAlternativesSeparator)
                     createUnTaggedAlternatives(w);
@@ -561,7 +587,18 @@ flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctu
             }
         }
     }
-    rewind(fpi);
+    reserve(0, lineno + 1);
+    exhausted = w == 0;
+    unsigned long last = lineno;
+    while (last > 0 && Lines[last] == 0) // Lines[l] is 0 if line l has no words
+        --last;
+    newlinesAfter = total ? lineno - last : lineno;
+    if (nice)
+        printf("... %lu words read in %lu lines\n", total, lineno);
+    if (chunk == ULONG_MAX || total >= size) // no next chunk
+        input.close();
+    if (chunk == ULONG_MAX)
+        rewind(fpi);
 
     makeList();
     if (nice)
@@ -571,61 +608,39 @@ flattext::flattext(FILE *fpi, bool a_InputHasTags, char *Iformat, int keepPunctu
 flattext::flattext(string str, int keepPunctuation, bool nice,
                    unsigned long int size, bool treatSlashAsAlternativesSeparator)
     : text(false, nice)
+{
+    fields = 0;
+    read(str, keepPunctuation, nice, size, treatSlashAsAlternativesSeparator);
+}
+
+/* An empty text, to be filled with read(). */
+flattext::flattext(bool nice)
+    : text(false, nice)
 {
     StartOfLine = true;
     fields = 0;
+}
+
+/* Read the words of str. The text must be empty, that is, new or cleared
+   (see text::clear). */
+void flattext::read(string str, int keepPunctuation, bool nice,
+                    unsigned long int size, bool treatSlashAsAlternativesSeparator)
+{
+    StartOfLine = true;
     const char *Tag;
     
     int slashFound = 0;
-    
-    if (nice)
-        LOG1LINE("counting words");
-    
-    lineno = 0;
-    string::size_type pos = 0;
-    
     unsigned long newlines;
     char *w;
+    flatinput in;
+    in.open(&str[0], str.size()); // str is a copy, the words are terminated in place
 
-    while (total < size && pos < str.size() && (w = getword(str, pos, Tag, keepPunctuation, slashFound, newlines)) != 0)
-    {
-        lineno += newlines;
-        if (*w)
-        {
-            ++total;
-            if (slashFound && treatSlashAsAlternativesSeparator)
-                total += slashFound;
-        }
-    }
-    if (nice)
-    {
-        printf("... %lu words counted in %lu lines\n", total, lineno);
-    }
-
-    if (nice)
-        LOG1LINE("allocating array of pointers to words");
-    tunsorted = new const Word *[total];
-    if (nice)
-        LOG1LINE("allocating array of line offsets");
-    Lines = new unsigned long int[lineno + 1];
-    unsigned long L = lineno + 1;
-    do
-    {
-        --L;
-        Lines[L] = 0;
-    } while (L != 0);
-    
-    if (nice)
-        LOG1LINE("...allocated array");
-
-    total = 0;
+    reserve(str.size() / 2 + 1, 1); // enough, unless punctuation is split off
     if (nice)
         LOG1LINE("reading words");
-    
     lineno = 0;
-    pos = 0;
 
-    while (total < size && pos < str.size() && (w = getword(str, pos, Tag, keepPunctuation, slashFound, newlines)) != 0)
+    while (total < size && (w = getword(in, Tag, false, keepPunctuation, slashFound, newlines)) != 0)
     {
         if (slashFound && treatSlashAsAlternativesSeparator)
             createUnTaggedAlternatives(w);
@@ -634,6 +649,9 @@ flattext::flattext(string str, int keepPunctuation, bool nice,
         lineno += newlines;
         StartOfLine = newlines != 0;
     }
+    reserve(0, lineno + 1);
+    if (nice)
+        printf("... %lu words read in %lu lines\n", total, lineno);
 
     makeList();
     if (nice)
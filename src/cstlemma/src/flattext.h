@@ -28,12 +28,35 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 class flattext : public text
 {
+private:
+    bool exhausted;                // all of the input has been read
+    unsigned long int newlinesAfter; // after the last word
+    bool full(unsigned long int chunk) const
+    {
+        return total >= chunk && StartOfLine;
+    }
+
 public:
+    /* With chunk < ULONG_MAX, reading stops at the first line end after
+       chunk words. The next chunk is read by the next flattext, which gets
+       the new lines after the last word of this one (trailingNewlines). */
     flattext(
-        FILE *fpi, bool InputHasTags, char *Iformat, int keepPunctuation, bool nice, unsigned long int size, bool treatSlashAsAlternativeSeparator);
+        FILE *fpi, bool InputHasTags, char *Iformat, int keepPunctuation, bool nice, unsigned long int size, bool treatSlashAsAlternativeSeparator,
+        unsigned long int chunk = ULONG_MAX, unsigned long int newlinesBefore = 0);
     flattext(
         std::string str, int keepPunctuation, bool nice, unsigned long int size, bool treatSlashAsAlternativeSeparator);
+    flattext(bool nice);
     ~flattext() {}
+    void read(std::string str, int keepPunctuation, bool nice, unsigned long int size, bool treatSlashAsAlternativeSeparator);
+    bool atEnd() const
+    {
+        return exhausted;
+    }
+    unsigned long int trailingNewlines() const
+    {
+        return newlinesAfter;
+    }
+    static void restart();
     virtual const char *convert(const char *s, char *buf, const char *lastBufByte);
     virtual void DoYourWork(
         FILE *fpi, optionStruct &Option){};
@@ -53,6 +53,14 @@ public:
         REFER(outputObj)
         return -1;
     }
+    virtual bool countable() const // count can return something else than -1
+    {
+        return false;
+    }
+    virtual const char *literal() const // text that doesn't depend on outputObj
+    {
+        return 0;
+    }
     virtual ~formattingFunction()
     {}
     virtual bool skip(const basefrm *bf) const = 0;
@@ -104,6 +112,10 @@ public:
     {
         str.append(arg);
     }
+    const char *literal() const
+    {
+        return arg;
+    }
     virtual bool skip(const basefrm *bf) const
     {
         REFER(bf)
@@ -135,6 +147,10 @@ public:
         REFER(bf)
         return false;
     }
+    bool countable() const
+    {
+        return m_fncount != 0;
+    }
     int count(const OutputClass *u) const
     {
         if (m_fncount)
@@ -170,6 +186,10 @@ public:
         REFER(bf)
         return false;
     }
+    bool countable() const
+    {
+        return m_fncount != 0;
+    }
     int count(const OutputClass *u) const
     {
         if (m_fncount)
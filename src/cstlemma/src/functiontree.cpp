@@ -28,10 +28,100 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <stdlib.h>
 
 #include <string>
+#include <vector>
 
 using namespace std;
 
-functionTree::functionTree() : m_fnc(NULL), next(NULL), child(NULL), m_comp(comparison::eany), m_nmbr(-1), Hidden(false)
+/*
+A functionTree is compiled into a flat program of steps: text, fields and
+tests. Adjacent texts are joined, hidden parts ([...]?) are left out, and a
+part that has a condition ([...], [...]2, $b2 etc.) gets a test step that
+jumps over the part if the condition isn't met. The condition is computed
+from lists, made at compile time, of the comparisons and the countable
+fields it depends on, so that output doesn't walk the tree.
+*/
+
+class formatCheck // [...]<n, [...]n, [...]~n, [...]>n
+{
+public:
+    comparison comp;
+    int nmbr;
+    size_t from, to; // in formatProgram::counters, the first that counts
+};
+
+class formatStep
+{
+public:
+    enum
+    {
+        text,
+        field,
+        test
+    } kind;
+    const formattingFunction *fnc; // field
+    size_t from, to;               // text: in formatProgram::text, test: in formatProgram::checks
+    bool nonZero;                  // test: also the first of count2from-count2to must not count 0
+    size_t count2from, count2to;
+    size_t next; // test: next step if the test fails
+};
+
+class formatProgram
+{
+public:
+    string text; // nul terminated texts
+    vector<formatStep> steps;
+    vector<formatCheck> checks;
+    vector<const formattingFunction *> counters;
+    size_t joinable; // a text step at this index or later may be extended
+    formatProgram() : joinable(0) {}
+    int count(size_t from, size_t to, const OutputClass *outputObj) const
+    {
+        for (size_t i = from; i < to; ++i)
+        {
+            int ret = counters[i]->count(outputObj);
+            if (ret != -1)
+                return ret;
+        }
+        return -1;
+    }
+    bool OK(const formatCheck &check, const OutputClass *outputObj) const;
+    bool skip(const formatStep &step, const OutputClass *outputObj) const
+    {
+        for (size_t i = step.from; i < step.to; ++i)
+            if (!OK(checks[i], outputObj))
+                return true;
+        return step.nonZero && count(step.count2from, step.count2to, outputObj) == 0;
+    }
+};
+
+bool formatProgram::OK(const formatCheck &check, const OutputClass *outputObj) const
+{
+    int cnt = count(check.from, check.to, outputObj);
+    if (cnt < 0)
+    {
+        fprintf(stderr, "Something wrong in field specification.\n"
+                        "The number-of-values specification %d is only valid if there is a field\n"
+                        "with a variable number of values.\n",
+                check.nmbr);
+
+        exit(0);
+    }
+    switch (check.comp)
+    {
+    case comparison::eless:
+        return cnt < check.nmbr;
+    case comparison::eequal:
+        return cnt == check.nmbr;
+    case comparison::enotequal:
+        return cnt != check.nmbr;
+    case comparison::emore:
+        return cnt > check.nmbr;
+    default:
+        return true;
+    }
+}
+
+functionTree::functionTree() : m_fnc(NULL), next(NULL), child(NULL), m_comp(comparison::eany), m_nmbr(-1), Hidden(false), program(NULL)
 {
 }
 
@@ -40,145 +130,203 @@ functionTree::~functionTree()
     delete m_fnc;
     delete next;
     delete child;
+    delete program;
 }
 
-void functionTree::printIt(const OutputClass *outputObj) const
+void functionTree::compile()
 {
-    if (!Hidden)
-    {
-        if (!skip(outputObj))
-        {
-            if (m_fnc)
-                m_fnc->doIt(outputObj);
-            if (child)
-            {
-                child->printIt(outputObj);
-            }
-        }
-    }
-    if (next)
-        next->printIt(outputObj);
+    delete program;
+    program = new formatProgram();
+    compile(*program);
 }
 
-void functionTree::writeIt(const OutputClass *outputObj, string &str) const
+// Add the steps for this part and the parts after it.
+void functionTree::compile(formatProgram &prog) const
 {
-    if (!Hidden)
+    for (const functionTree *part = this; part; part = part->next)
     {
-        if (!skip(outputObj))
+        if (part->Hidden)
+            continue;
+        size_t test = prog.steps.size();
+        if (part->m_comp != comparison::eany)
         {
-            if (m_fnc)
+            part->addTest(prog);
+            prog.joinable = prog.steps.size();
+        }
+        if (part->m_fnc)
+        {
+            const char *literal = part->m_fnc->literal();
+            if (literal && prog.steps.size() > prog.joinable && prog.steps.back().kind == formatStep::text)
             {
-                m_fnc->toString(outputObj, str);
+                prog.text.resize(prog.steps.back().to);
+                prog.text.append(literal);
+                prog.steps.back().to = prog.text.size();
+                prog.text.push_back('\0');
             }
-            if (child)
+            else
             {
-                child->writeIt(outputObj, str);
+                formatStep step;
+                step.kind = literal ? formatStep::text : formatStep::field;
+                step.fnc = part->m_fnc;
+                step.from = step.to = 0;
+                if (literal)
+                {
+                    step.from = prog.text.size();
+                    prog.text.append(literal);
+                    step.to = prog.text.size();
+                    prog.text.push_back('\0');
+                }
+                prog.steps.push_back(step);
             }
         }
+        if (part->child)
+            part->child->compile(prog);
+        if (part->m_comp != comparison::eany)
+        {
+            prog.steps[test].next = prog.steps.size();
+            prog.joinable = prog.steps.size();
+        }
     }
-    if (next)
-        next->writeIt(outputObj, str);
 }
 
-int functionTree::count(const OutputClass *outputObj) const
+/* The test of a part with a condition. [...] is skipped if a nested
+   condition isn't met or if the first countable thing that isn't inside a
+   nested condition counts zero. [...]n and $bn are skipped if their count
+   doesn't meet the condition. */
+void functionTree::addTest(formatProgram &prog) const
 {
-    int ret = -1;
-    if (m_fnc)
-        ret = m_fnc->count(outputObj);
-    if (ret == -1 && child)
-        ret = child->count(outputObj);
-    if (ret == -1 && next)
-        ret = next->count(outputObj);
-    return ret;
+    formatStep step;
+    step.kind = formatStep::test;
+    step.fnc = 0;
+    step.from = prog.checks.size();
+    step.nonZero = false;
+    step.count2from = step.count2to = 0;
+    if (m_comp == comparison::etest)
+    {
+        assert(!m_fnc);
+        assert(child);
+        child->addChecks(prog);
+        step.nonZero = true;
+        step.count2from = prog.counters.size();
+        child->addCount2(prog);
+        step.count2to = prog.counters.size();
+    }
+    else
+    {
+        formatCheck check;
+        check.comp = m_comp;
+        check.nmbr = m_nmbr;
+        check.from = prog.counters.size();
+        if (child)
+            child->addCount(prog);
+        else // $b2
+            addCount(prog);
+        check.to = prog.counters.size();
+        prog.checks.push_back(check);
+    }
+    step.to = prog.checks.size();
+    step.next = 0;
+    prog.steps.push_back(step);
 }
 
-int functionTree::count2(const OutputClass *outputObj) const
+// The comparisons in this part and the parts after it, nested ones included.
+void functionTree::addChecks(formatProgram &prog) const
 {
-    int ret = -1;
-    if (m_comp != comparison::eless && m_comp != comparison::eequal && m_comp != comparison::emore && m_comp != comparison::enotequal)
+    if (isComparison())
     {
-        if (m_fnc)
-            ret = m_fnc->count(outputObj);
-        if (ret == -1 && child)
-        {
-            ret = child->count2(outputObj);
-        }
+        formatCheck check;
+        check.comp = m_comp;
+        check.nmbr = m_nmbr;
+        check.from = prog.counters.size();
+        if (child)
+            child->addCount(prog);
+        else
+            addCount(prog);
+        check.to = prog.counters.size();
+        prog.checks.push_back(check);
     }
-    if (ret == -1 && next)
-        ret = next->count2(outputObj);
-    return ret;
+    if (m_comp != comparison::etest && child)
+        child->addChecks(prog);
+    if (next)
+        next->addChecks(prog);
 }
 
-bool functionTree::OK(const OutputClass *outputObj) const
+// The countable fields, in the order in which they are tried.
+void functionTree::addCount(formatProgram &prog) const
 {
-    int cnt = -1;
-    switch (m_comp)
-    {
-    case comparison::eless:
-    case comparison::eequal:
-    case comparison::enotequal:
-    case comparison::emore:
-        if (child)
-        {
-            assert(child);
-            cnt = child->count(outputObj);
-        }
-        else // $b2
-            cnt = count(outputObj);
-        if (cnt < 0)
-        {
-            fprintf(stderr, "Something wrong in field specification.\n"
-                            "The number-of-values specification %d is only valid if there is a field\n"
-                            "with a variable number of values.\n",
-                    m_nmbr);
+    if (m_fnc && m_fnc->countable())
+        prog.counters.push_back(m_fnc);
+    if (child)
+        child->addCount(prog);
+    if (next)
+        next->addCount(prog);
+}
 
-            exit(0);
-        }
-    default:;
-    }
-    switch (m_comp)
+// As addCount, but not looking inside comparisons.
+void functionTree::addCount2(formatProgram &prog) const
+{
+    if (!isComparison())
     {
-    case comparison::eless:
-        return cnt < m_nmbr;
-    case comparison::eequal:
-        return cnt == m_nmbr;
-    case comparison::enotequal:
-        return cnt != m_nmbr;
-    case comparison::emore:
-        return cnt > m_nmbr;
-    default:
-        return true;
+        if (m_fnc && m_fnc->countable())
+            prog.counters.push_back(m_fnc);
+        if (child)
+            child->addCount2(prog);
     }
+    if (next)
+        next->addCount2(prog);
 }
 
-bool functionTree::passTest(const OutputClass *outputObj) const
+void functionTree::printIt(const OutputClass *outputObj) const
 {
-    if (OK(outputObj))
+    assert(program);
+    const formatStep *steps = program->steps.data();
+    size_t n = program->steps.size();
+    for (size_t i = 0; i < n;)
     {
-        if (m_comp != comparison::etest && child && !child->passTest(outputObj))
-            return false;
-        if (next)
-            return next->passTest(outputObj);
-        return true;
+        const formatStep &step = steps[i];
+        switch (step.kind)
+        {
+        case formatStep::text:
+            fputs(program->text.c_str() + step.from, functionString::fp);
+            break;
+        case formatStep::field:
+            step.fnc->doIt(outputObj);
+            break;
+        case formatStep::test:
+            if (program->skip(step, outputObj))
+            {
+                i = step.next;
+                continue;
+            }
+        }
+        ++i;
     }
-    else
-        return false;
 }
 
-bool functionTree::skip(const OutputClass *outputObj) const
+void functionTree::writeIt(const OutputClass *outputObj, string &str) const
 {
-    if (m_comp == comparison::etest) // bare [...] (no comparisons)
-    // [...] tests for two situations:
-    // 1) whether nested [...] have conditions that are not met and
-    // 2) whether anything countable that is not between [...]0 or [...]<1 returns zero
-    // If either of these situations occur, the actions between [ and ] are skipped.
-    // Notice that a [...] always succeeds, as does [...]* and ... (an expression without [ and ])
+    assert(program);
+    const formatStep *steps = program->steps.data();
+    size_t n = program->steps.size();
+    for (size_t i = 0; i < n;)
     {
-        assert(!m_fnc);
-        assert(child);
-        return !child->passTest(outputObj) || child->count2(outputObj) == 0;
+        const formatStep &step = steps[i];
+        switch (step.kind)
+        {
+        case formatStep::text:
+            str.append(program->text, step.from, step.to - step.from);
+            break;
+        case formatStep::field:
+            step.fnc->toString(outputObj, str);
+            break;
+        case formatStep::test:
+            if (program->skip(step, outputObj))
+            {
+                i = step.next;
+                continue;
+            }
+        }
+        ++i;
     }
-    else
-        return !OK(outputObj);
 }
 #endif
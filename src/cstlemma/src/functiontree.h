@@ -31,8 +31,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 class formattingFunction;
 class OutputClass;
+class formatProgram;
 //typedef enum comparison;
 
+/* The parsed form of a format string (see OutputClass::Format). Before it is
+   used, the tree is compiled into a flat program (see functiontree.cpp). */
 class functionTree
     {
 #ifdef COUNTOBJECTS
@@ -46,16 +49,23 @@ class functionTree
         comparison m_comp;
         int m_nmbr;      // number of OutputClass elements (success/failure criterion)
         bool Hidden;
+        formatProgram * program; // root only
+        bool isComparison() const
+            {
+            return m_comp == comparison::eless || m_comp == comparison::eequal || m_comp == comparison::emore || m_comp == comparison::enotequal;
+            }
+        void compile(formatProgram & prog) const;
+        void addTest(formatProgram & prog) const;
+        void addChecks(formatProgram & prog) const;
+        void addCount(formatProgram & prog) const;
+        void addCount2(formatProgram & prog) const;
     public:
         functionTree();
         ~functionTree();
         void hide(){Hidden=true;}
-        bool passTest(const OutputClass * outputObj)const;
-        bool OK(const OutputClass * outputObj)const;
+        void compile();
         void printIt(const OutputClass * outputObj)const;
         void writeIt(const OutputClass * outputObj, std::string &str)const;
-        int count(const OutputClass * outputObj)const;
-        int count2(const OutputClass * outputObj)const;
         void setFunction(formattingFunction * fnc)
             {
             this->m_fnc = fnc;
@@ -78,7 +88,6 @@ class functionTree
             {
             this->m_nmbr = nmbr;
             }
-        bool skip(const OutputClass * outputObj)const;
     };
 
 #endif
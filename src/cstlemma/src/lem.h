@@ -50,5 +50,122 @@ typedef struct
     unsigned int Offset:8;       // String length max 255
     unsigned int frequency:24;   // Max frequency 16.777.215
     } tsundry;
+
+/*
+Memory mappable dictionary (format version 2).
+The file starts with a tdictheader, followed by the sections that the header
+points to. Each section starts at a multiple of DICTALIGN bytes from the
+start of the file. Sections contain indices, never pointers, and have the
+same layout as the arrays that the lemmatiser uses, so the lemmatiser can use
+the file image as it is, without a fix-up pass.
+The old format (version 1) has no header. It starts with the length of the
+string pool.
+*/
+#define DICTMAGIC "CSTLDICT"
+#define DICTVERSION 2
+#define DICTALIGN 8
+#define DICTBYTEORDER 0x01020304
+#define DICTMAXSECTIONS 16
+
+enum dictSection
+    {
+    DS_STRINGS,          // char[]: '\0' followed by all strings. Index 0 is
+                         // the empty string.
+    DS_LEXT,             // lext[nlext]: {Type index, BaseFormSuffix index, S}
+    DS_INITIALCHARS,     // INT32[nnodes]: first character of each node's string
+    DS_NODESTRINGS,      // tindex[nnodes]: index into DS_STRINGS
+    DS_POS,              // tindex[nnodes]: >= 0: index into DS_LEXT
+                         //                  < 0: -(index of first child node)
+    DS_NUMBEROFCHILDREN, // tchildren[nnodes]
+    DS_DABASE,           // INT32[]: double-array trie over the full forms
+    DS_DACHECK,          // INT32[]: (optional). See below.
+    DS_BLOOM,            // tbloomheader + bits: (optional) Bloom filter over
+                         // the full forms. See bloomfilter.h
+    DS_LEAFINFO,         // tleafinfo[nlext]: (optional) See below.
+    DS_TYPES,            // tindex[]: (optional) index into DS_STRINGS of each
+                         // distinct type in DS_LEXT. (Strings are stored only
+                         // once, so equal types have equal indices.)
+    DS_FCSTRINGS         // tfcheader + ...: (optional) front coded node
+                         // strings. See below.
+    };
+
+typedef struct
+    {
+    INT32 nbits;
+    INT32 nhashes;
+    } tbloomheader; // followed by (nbits + 7) / 8 bytes
+
+/*
+Double-array trie (optional sections DS_DABASE and DS_DACHECK)
+State 0 is the root. Byte b of a full form moves from state s to state
+t = base[s] + b + 1, provided that check[t] == s. At the end of the full
+form, t = base[s] (code 0) must have check[t] == s. Then -base[t] - 1 is
+the index of the leaf node in DS_POS and DS_NUMBEROFCHILDREN.
+*/
+
+/*
+Disambiguation data (optional section DS_LEAFINFO)
+For each full form with more than one reading, the record at the index in
+DS_LEXT of its first reading summarises the readings, as the lemmatiser
+would otherwise compute them for each look-up (Word::maxFrequency,
+Word::commonType and Word::commonStem with untagged input):
+S.frequency  the highest frequency of the readings
+nmax         the number of readings with that frequency
+iType        index of the type that all these readings share, or -1
+iStemSuffix  index of the base form suffix that all these readings share
+             after removing S.Offset bytes from the full form, or -1
+Records at other indices are all zero.
+*/
+typedef struct
+    {
+    tindex iType;
+    tindex iStemSuffix;
+    tsundry S;
+    INT32 nmax;
+    } tleafinfo;
+
+/*
+Front coded node strings (optional section DS_FCSTRINGS)
+If present, DS_NODESTRINGS holds the number of each node's string in this
+section instead of an index into DS_STRINGS, and DS_STRINGS only has the
+types and base form suffixes. The node strings are sorted and stored in
+blocks of blocksize strings:
+
+    tfcheader, INT32 blockoffset[nblocks], blocks
+
+Block offsets count from the end of the blockoffset array. A block starts
+with a zero terminated string. Each following string is stored as one byte
+with the length of the prefix it shares with its predecessor, followed by
+the rest of the string, zero terminated. Strings are shorter than
+DICTFCMAXSTRING bytes.
+*/
+#define DICTFCBLOCK 8
+#define DICTFCMAXSTRING 256
+
+typedef struct
+    {
+    INT32 nstrings;
+    INT32 blocksize;
+    } tfcheader;
+
+typedef struct
+    {
+    tcount offset; // from start of file, 0 if the section is absent
+    tcount size;   // in bytes
+    } tdictsection;
+
+typedef struct
+    {
+    char magic[8];                 // DICTMAGIC, not zero terminated
+    INT32 version;                 // DICTVERSION
+    INT32 byteorder;               // DICTBYTEORDER
+    unsigned char sizeofindex;     // sizeof(tindex)
+    unsigned char sizeoflext;      // size of a record in DS_LEXT
+    unsigned char utf8;            // initialchars are UTF-8 decoded
+    tchildren ntoplevel;
+    tcount nnodes;
+    tcount nlext;
+    tdictsection section[DICTMAXSECTIONS];
+    } tdictheader;
 #endif
 #endif
@@ -31,11 +31,20 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "XMLtext.h"
 #include "flattext.h"
 #include "lemmtags.h"
+#include "warmcache.h"
+#include "bundle.h"
 #ifdef _MSC_VER
 #include <io.h>
 #endif
+#if !defined _WIN32
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 #include <stdarg.h>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include <time.h>
 #include <limits.h>
 
@@ -81,6 +90,9 @@ const char *Lemmatiser::translate(const char *tag)
 
 Lemmatiser::Lemmatiser(optionStruct &a_Option) : listLemmas(0), SortInput(false), Option(a_Option), changed(true)
 {
+#if defined PROGLEMMATISE
+    session = 0;
+#endif
     nice = Option.nice;
     instance++;
     if (instance == 1)
@@ -102,6 +114,13 @@ Lemmatiser::Lemmatiser(optionStruct &a_Option) : listLemmas(0), SortInput(false)
         {
 #if defined PROGMAKESUFFIXFLEX
             status = MakeFlexPatterns();
+#endif
+            break;
+        }
+        case whattodoTp::MAKEBUNDLE:
+        {
+#if defined PROGLEMMATISE
+            status = MakeBundle();
 #endif
             break;
         }
@@ -134,6 +153,10 @@ Lemmatiser::~Lemmatiser()
     {
         break;
     }
+    case whattodoTp::MAKEBUNDLE:
+    {
+        break;
+    }
     default:
     {
 #if defined PROGLEMMATISE
@@ -159,6 +182,10 @@ int Lemmatiser::MakeDict()
     FILE *fpin;
     FILE *fpout;
     FILE *ffreq = 0;
+#if defined PROGLEMMATISE
+    if (Option.dictfile)
+        return MergeDict();
+#endif
     if (!Option.cformat)
     {
         LOG1LINE("You need to specify a column-order with the -c option");
@@ -187,7 +214,7 @@ int Lemmatiser::MakeDict()
     }
     else
         fpout = stdout;
-    int ret = makedict(fpin, fpout, nice, Option.cformat, Option.freq, Option.CollapseHomographs);
+    int ret = makedict(fpin, fpout, nice, Option.cformat, Option.freq, Option.CollapseHomographs, Option.DictVersion, Option.DoubleArray, Option.FrontCoded, Option.BloomRate);
     if (fpin != stdin)
         fclose(fpin);
     if (fpout != stdout)
@@ -196,6 +223,104 @@ int Lemmatiser::MakeDict()
         fclose(ffreq);
     return ret;
 }
+
+#if defined PROGLEMMATISE
+/* Make a new dictionary (-o) from a dictionary (-d) and a delta dictionary
+   (-O). */
+int Lemmatiser::MergeDict()
+{
+    FILE *fpdict = fopen(Option.dictfile, "rb");
+    if (!fpdict)
+    {
+        cannotOpenFile("Cannot open dictionary", Option.dictfile, "for reading");
+        return -1;
+    }
+    if (Option.delta)
+    {
+        FILE *fpdelta = fopen(Option.delta, "r");
+        if (!fpdelta)
+        {
+            fclose(fpdict);
+            cannotOpenFile("Cannot open delta dictionary", Option.delta, "for reading");
+            return -1;
+        }
+        dictionary::setDelta(fpdelta);
+        fclose(fpdelta);
+    }
+    bool loaded = dict.initdict(fpdict, -1.0);
+    fclose(fpdict);
+    if (!loaded)
+    {
+        LOG1LINE("Cannot read the dictionary");
+        return -1;
+    }
+    FILE *fpin = tmpfile();
+    FILE *ffreq = tmpfile();
+    if (!fpin || !ffreq)
+    {
+        LOG1LINE("Cannot create temporary files");
+        if (fpin)
+            fclose(fpin);
+        if (ffreq)
+            fclose(ffreq);
+        return -1;
+    }
+    dictionary::dump(fpin, ffreq);
+    rewind(fpin);
+    rewind(ffreq);
+    FILE *fpout = stdout;
+    if (Option.argo)
+    {
+        fpout = fopen(Option.argo, "wb");
+        if (!fpout)
+        {
+            cannotOpenFile("Cannot open binary dictionary", Option.argo, "for writing");
+            fclose(fpin);
+            fclose(ffreq);
+            return -1;
+        }
+    }
+    int ret = makedict(fpin, fpout, nice, "FBT", Option.freq, Option.CollapseHomographs, Option.DictVersion, Option.DoubleArray, Option.FrontCoded, Option.BloomRate, ffreq);
+    fclose(fpin);
+    fclose(ffreq);
+    if (fpout != stdout)
+        fclose(fpout);
+    return ret;
+}
+#endif
+#endif
+
+#if defined PROGLEMMATISE
+/* Make a model bundle (-o) from the flex rules (-f), the tag specific flex
+   rules next to them, and the files given with -d, -v, -x and -z. */
+int Lemmatiser::MakeBundle()
+{
+    if (!Option.flx)
+    {
+        LOG1LINE("-f  Flexpatterns: File not specified.");
+        return -1;
+    }
+    if (!Option.argo)
+    {
+        LOG1LINE("You need to specify the bundle file with the -o option");
+        return -1;
+    }
+    FILE *fpout = fopen(Option.argo, "wb");
+    if (!fpout)
+    {
+        cannotOpenFile("Cannot open bundle", Option.argo, "for writing");
+        return -1;
+    }
+    bool ok = bundle::pack(fpout, Option.flx, Option.dictfile, Option.v, Option.x, Option.z);
+    if (fclose(fpout) != 0)
+        ok = false;
+    if (!ok)
+    {
+        remove(Option.argo);
+        return -1;
+    }
+    return 0;
+}
 #endif
 
 #if defined PROGMAKESUFFIXFLEX
@@ -260,7 +385,8 @@ int Lemmatiser::setFormats()
     if (!Option.Bformat && !Option.bformat && !Option.cformat && !Option.Wformat)
     {
         Option.setBformat(optionStruct::Default_B_format);
-        if (Option.dictfile)
+        size_t size;
+        if (Option.dictfile || bundle::section(BS_DICT, size, false))
         {
             Option.setbformat(optionStruct::Default_b_format);
             Option.setcformat(
@@ -347,6 +473,11 @@ int Lemmatiser::setFormats()
         if (listLemmas || Option.UseLemmaFreqForDisambiguation < 2)
             SortInput = true; // performance
     }
+    if (SortInput && chunked())
+    {
+        LOG1LINE("-S cannot be used with $f, -H0 or -H1, which need the frequencies in the whole input.");
+        return -1;
+    }
     if (!Option.XML)
         info("-X-\tNot XML input.");
 
@@ -395,6 +526,24 @@ int Lemmatiser::setFormats()
     return 0;
 }
 
+/* If the flex rules file (-f) is a model bundle, map it. Its sections stand
+   in for the files that are not given explicitly. */
+int Lemmatiser::openBundle()
+{
+    if (Option.flx)
+    {
+        switch (bundle::open(Option.flx))
+        {
+        case 1:
+            info("-f\t%s\tModel bundle.", Option.flx);
+            break;
+        case -1:
+            return -1;
+        }
+    }
+    return 0;
+}
+
 int Lemmatiser::openFiles()
 {
     FILE *fpflex;
@@ -402,9 +551,11 @@ int Lemmatiser::openFiles()
     FILE *fpv = 0;
     FILE *fpx = 0;
     FILE *fpz = 0;
+    const char *dictimage = 0;
+    size_t dictsize = 0;
     if (Option.flx)
     {
-        fpflex = fopen(Option.flx, "rb");
+        fpflex = bundle::isOpen() ? bundle::stream(BS_FLEXRULES) : fopen(Option.flx, "rb");
         if (fpflex)
         {
             info("-f\t%s\tFile with flex patterns.", Option.flx);
@@ -433,11 +584,30 @@ int Lemmatiser::openFiles()
             return -1;
         }
     }
+    else if ((dictimage = bundle::section(BS_DICT, dictsize, false)) != 0)
+    {
+        info("-d\t%s\tDictionary in model bundle.", Option.flx);
+    }
     else
     {
         info("-d\tDictionary: File not specified.");
     }
 
+    if (Option.delta)
+    {
+        FILE *fpdelta = fopen(Option.delta, "r");
+        if (!fpdelta)
+        {
+            cannotOpenFile("-O\t", Option.delta, "\t(Delta dictionary): Cannot open file.");
+            return -1;
+        }
+        if (!fpdict && !dictimage)
+            info("-O\t%s\tDelta dictionary ignored: no dictionary (-d).", Option.delta);
+        else if (dictionary::setDelta(fpdelta))
+            info("-O\t%s\tDelta dictionary.", Option.delta);
+        fclose(fpdelta);
+    }
+
     if (Option.InputHasTags)
     {
         if (Option.v)
@@ -451,6 +621,8 @@ int Lemmatiser::openFiles()
             else
                 info("-v\t%-20s\tTag friends file", Option.v);
         }
+        else if ((fpv = bundle::stream(BS_TAGFRIENDS)) != 0)
+            info("-v\t%-20s\tTag friends in model bundle", Option.flx);
         else
             info("-v\tTag friends file: File not specified.");
 
@@ -465,6 +637,8 @@ int Lemmatiser::openFiles()
             else
                 info("-x\t%-20s\tLexical type translation table", Option.x);
         }
+        else if ((fpx = bundle::stream(BS_TYPETABLE)) != 0)
+            info("-x\t%-20s\tLexical type translation table in model bundle", Option.flx);
         else
             info("-x\tLexical type translation table: File not specified.");
 
@@ -479,6 +653,8 @@ int Lemmatiser::openFiles()
             else
                 info("-z\t%-20s\tFull form - Lemma type conversion table", Option.z);
         }
+        else if ((fpz = bundle::stream(BS_LEMMATAGS)) != 0)
+            info("-z\t%-20s\tFull form - Lemma type conversion table in model bundle", Option.flx);
         else
             info("-z\tFull form - Lemma type conversion table: File not specified.");
     }
@@ -495,6 +671,8 @@ int Lemmatiser::openFiles()
             else
                 info("-z\t%-20s\tFull form - Lemma type conversion table", Option.z);
         }
+        else if ((fpz = bundle::stream(BS_LEMMATAGS)) != 0)
+            info("-z\t%-20s\tFull form - Lemma type conversion table in model bundle", Option.flx);
     }
 
     if (fpflex)
@@ -554,15 +732,46 @@ int Lemmatiser::openFiles()
         fclose(fpz);
     }
 
-    if (nice && fpdict)
-        printf("\nreading dictionary \"%s\"\n", Option.dictfile);
+    if (nice && (fpdict || dictimage))
+        printf("\nreading dictionary \"%s\"\n", fpdict ? Option.dictfile : Option.flx);
 
-    dict.initdict(fpdict);
-    if (fpdict)
-        fclose(fpdict);
+    if (dictimage)
+        dict.initdict(dictimage, dictsize, Option.BloomRate); // in place, no need to load in the background
+    else if (Option.AsyncDict && fpdict)
+        dict.initdictAsync(fpdict, Option.BloomRate); // closes fpdict
+    else
+    {
+        dict.initdict(fpdict, Option.BloomRate);
+        if (fpdict)
+            fclose(fpdict);
+    }
+
+    warmcache::setModel(Option.flx, Option.dictfile, Option.dictfile || dictimage ? Option.delta : NULL, Option.InputHasTags ? Option.v : NULL, Option.InputHasTags ? Option.x : NULL, Option.z, Option.arge);
+    if (Option.warmcache)
+        loadWarmCache(Option.warmcache);
+    if (Option.warmcacheout)
+        recordTraffic(Option.warmsize);
     return 0;
 }
 
+bool Lemmatiser::loadWarmCache(const char *filename)
+{
+    if (!warmcache::load(filename))
+        return false;
+    info("-K\t%-20s\tWarm cache", filename);
+    return true;
+}
+
+void Lemmatiser::recordTraffic(size_t ntypes)
+{
+    warmcache::record(ntypes);
+}
+
+bool Lemmatiser::saveWarmCache(const char *filename, size_t ntypes)
+{
+    return warmcache::write(filename, ntypes);
+}
+
 void Lemmatiser::showSwitches()
 {
     info("\nSwitches:");
@@ -673,6 +882,19 @@ void Lemmatiser::showSwitches()
     else
         info("-m0\tReading unlimited number of words from input (default).");
 
+    if (Option.threads > 1)
+        info("-J%d\tSorting words and lemmas in %d threads", Option.threads, Option.threads);
+
+    if (chunked())
+        info("-S%lu\tLemmatising the input in chunks of about %lu words", Option.chunk, Option.chunk);
+    else if (Option.chunk)
+        info("-S%lu\tIgnored: the output is sorted or lists lemmas, or the input is XML.", Option.chunk);
+
+    if (sharded())
+        info("-j%d\tLemmatising parts of the input in %d processes", Option.jobs, Option.jobs);
+    else if (Option.jobs > 1)
+        info("-j%d\tIgnored: one process is needed for these options.", Option.jobs);
+
     if (Option.arge)
     {
         if ('0' < *Option.arge && *Option.arge <= '9')
@@ -691,7 +913,11 @@ void Lemmatiser::showSwitches()
 int Lemmatiser::LemmatiseInit()
 {
     changed = true;
-    int ret = setFormats();
+    int ret = openBundle();
+    if (ret)
+        return ret;
+
+    ret = setFormats();
     if (ret)
         return ret;
 
@@ -703,10 +929,300 @@ int Lemmatiser::LemmatiseInit()
     return 0;
 }
 
+/* Whether the input is lemmatised in chunks (-S). Only output in input order
+   can be written chunk by chunk. */
+bool Lemmatiser::chunked()
+{
+    return Option.chunk && !Option.XML && !listLemmas && !Option.SortOutput;
+}
+
+/* Lemmatise the input one chunk of Option.chunk words at a time, so that the
+   memory taken by a text is bounded. The warm cache keeps the look-ups of
+   the most frequent words from chunk to chunk. The word counts in tally are
+   the sums of those of the chunks. Types are not counted, because they are
+   only reported if SortInput, which setFormats does not allow with -S.
+   A capitalised type that only occurs at line starts is looked up as segment
+   initial. If the input can be read twice, a first pass finds the types that
+   occur inside a line anywhere in the input, so that the output is the same
+   as without chunks. Otherwise (a pipe) this is decided per chunk. */
+void Lemmatiser::LemmatiseChunks(FILE *fpin, FILE *fpout, tallyStruct *tally)
+{
+    std::unordered_set<std::string> inside;
+    LONG start = FTELL(fpin);
+    bool twice = start >= 0;
+    if (twice)
+    {
+        if (nice)
+            LOG1LINE("finding the capitalised words inside lines");
+        readChunks(fpin, 0, 0, &inside);
+        flattext::restart();
+        twice = FSEEK(fpin, start, SEEK_SET) == 0;
+    }
+    warmcache::reuse(Option.warmsize);
+    readChunks(fpin, fpout, tally, twice ? &inside : 0);
+}
+
+/* Read the input in chunks. Without fpout, only add the capitalised types
+   that occur inside a line to inside. With fpout, lemmatise each chunk and
+   write it out. */
+void Lemmatiser::readChunks(FILE *fpin, FILE *fpout, tallyStruct *tally, std::unordered_set<std::string> *inside)
+{
+    unsigned long int words = 0;
+    unsigned long int newlines = 0;
+    bool more = true;
+    while (more)
+    {
+        flattext *Text = new flattext(fpin, Option.InputHasTags, Option.Iformat, Option.keepPunctuation, nice, Option.size - words, Option.treatSlashAsAlternativesSeparator, Option.chunk, newlines);
+        if (!fpout)
+        {
+            Text->typesInsideLines(*inside);
+            words += Text->words();
+        }
+        else
+        {
+            if (inside)
+                Text->notSegmentInitial(*inside);
+            tallyStruct chunkTally;
+            Text->Lemmatise(fpout, Option.Sep, &chunkTally, Option.SortOutput, Option.UseLemmaFreqForDisambiguation, nice, Option.DictUnique, Option.RulesUnique, Option.baseformsAreLowercase, listLemmas, false);
+            if (tally)
+            {
+                tally->totcnt += chunkTally.totcnt;
+                tally->newcnt += chunkTally.newcnt;
+                tally->newhom += chunkTally.newhom;
+            }
+            words += chunkTally.totcnt;
+        }
+        newlines = Text->trailingNewlines();
+        more = !Text->atEnd() && words < Option.size;
+        delete Text;
+    }
+}
+
+/* Whether the input is lemmatised in -j parts. The output of the parts is
+   only the same as that of the whole input if the output is in input order
+   and does not depend on frequencies in the whole input. */
+bool Lemmatiser::sharded()
+{
+#if defined _WIN32
+    return false;
+#else
+    return Option.jobs > 1 && !Option.XML && !listLemmas && !Option.SortOutput && !SortInput && !Option.Iformat && Option.size == ULONG_MAX && !Option.chunk && !Option.warmcacheout;
+#endif
+}
+
+#if !defined _WIN32
+#define SHARDMIN 0x10000 // Smaller inputs are not split up.
+
+/* A part of the input (-j). */
+struct shard
+{
+    const char *begin;
+    size_t length;
+    unsigned long int newlinesBefore; // at the end of the previous parts
+    FILE *out;                        // lemmatised text
+    FILE *results;                    // types, word counts
+};
+
+/* Child process. Without inside, write the capitalised types in s that occur
+   inside a line to s.results. Otherwise lemmatise s with the types in inside
+   not segment initial, write the text to s.out and the word counts, look-up
+   statistics and types to s.results. */
+static bool lemmatiseShard(optionStruct &Option, int listLemmas, shard &s, const std::unordered_set<std::string> *inside)
+{
+    FILE *fp = fmemopen((void *)s.begin, s.length, "rb");
+    if (!fp)
+        return false;
+    flattext::restart();
+    flattext *Text = new flattext(fp, Option.InputHasTags, Option.Iformat, Option.keepPunctuation, false, ULONG_MAX, Option.treatSlashAsAlternativesSeparator, ULONG_MAX, s.newlinesBefore);
+    fclose(fp);
+    if (!inside)
+    {
+        std::unordered_set<std::string> keys;
+        Text->typesInsideLines(keys);
+        for (std::unordered_set<std::string>::const_iterator k = keys.begin(); k != keys.end(); ++k)
+            fprintf(s.results, "%s\n", k->c_str());
+    }
+    else
+    {
+        Text->notSegmentInitial(*inside);
+        tallyStruct tally;
+        Text->Lemmatise(s.out, Option.Sep, &tally, Option.SortOutput, Option.UseLemmaFreqForDisambiguation, false, Option.DictUnique, Option.RulesUnique, Option.baseformsAreLowercase, listLemmas, false);
+        unsigned long probes = 0, rejects = 0, hits = 0, cacheProbes = 0;
+        dictionary::filterStatistics(probes, rejects);
+        warmcache::statistics(cacheProbes, hits);
+        fprintf(s.results, "%lu %lu %lu %lu %lu %lu %lu\n", tally.totcnt, tally.newcnt, tally.newhom, probes, rejects, cacheProbes, hits);
+        Text->writeTypes(s.results);
+    }
+    return fflush(s.out) == 0 && fflush(s.results) == 0;
+}
+
+/* Run lemmatiseShard for each shard in a process of its own and wait for
+   all of them. The processes share the model with this one. */
+static bool forkShards(optionStruct &Option, int listLemmas, std::vector<shard> &shards, const std::unordered_set<std::string> *inside)
+{
+    std::vector<pid_t> children;
+    bool ok = true;
+    fflush(NULL);
+    for (size_t i = 0; i < shards.size() && ok; ++i)
+    {
+        rewind(shards[i].out);
+        rewind(shards[i].results);
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(lemmatiseShard(Option, listLemmas, shards[i], inside) ? 0 : 1);
+        if (pid < 0)
+            ok = false;
+        else
+            children.push_back(pid);
+    }
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        int status;
+        if (waitpid(children[i], &status, 0) != children[i] || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ok = false;
+    }
+    return ok;
+}
+
+/* Lemmatise the input in Option.jobs parts at the same time. The input is
+   mapped and split at line ends. In a first round, each part finds its
+   capitalised types that occur inside a line. The union of these tells the
+   second round which types are not segment initial. The lemmatised parts
+   are written to fpout in input order. tally gets the sums of the word
+   counts of the parts and the counts of the union of their types.
+   False if nothing has been written, e.g. if the input is not a file or a
+   process failed. */
+bool Lemmatiser::LemmatiseShards(FILE *fpin, FILE *fpout, tallyStruct *tally)
+{
+    LONG start = FTELL(fpin);
+    if (start < 0 || FSEEK(fpin, 0, SEEK_END) != 0)
+        return false;
+    LONG end = FTELL(fpin);
+    FSEEK(fpin, start, SEEK_SET);
+    if (end - start < 2 * SHARDMIN)
+        return false;
+    size_t size = (size_t)end;
+    char *image = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(fpin), 0);
+    if (image == (char *)MAP_FAILED)
+        return false;
+
+    std::vector<shard> shards;
+    const char *p = image + start;
+    const char *last = image + size;
+    size_t share = (size - start) / Option.jobs;
+    if (share < SHARDMIN)
+        share = SHARDMIN;
+    while (p < last)
+    {
+        shard s;
+        s.begin = p;
+        s.newlinesBefore = 0;
+        for (const char *q = p; q > image + start && isSpace(q[-1]); --q)
+            if (q[-1] == '\n')
+                ++s.newlinesBefore;
+        if ((size_t)(last - p) < 2 * share)
+            p = last;
+        else
+        {
+            p = (const char *)memchr(p + share, '\n', last - p - share);
+            p = p ? p + 1 : last;
+        }
+        s.length = p - s.begin;
+        s.out = s.results = 0;
+        shards.push_back(s);
+    }
+    bool ok = shards.size() > 1;
+    for (size_t i = 0; i < shards.size() && ok; ++i)
+    {
+        shards[i].out = tmpfile();
+        shards[i].results = tmpfile();
+        ok = shards[i].out && shards[i].results;
+    }
+    std::unordered_set<std::string> inside;
+    if (ok && nice)
+        LOG1LINE("finding the capitalised words inside lines");
+    ok = ok && forkShards(Option, listLemmas, shards, 0);
+    for (size_t i = 0; i < shards.size() && ok; ++i)
+    {
+        char line[2048];
+        rewind(shards[i].results);
+        while (fgets(line, sizeof(line), shards[i].results))
+        {
+            line[strcspn(line, "\n")] = '\0';
+            inside.insert(line);
+        }
+    }
+    if (ok && nice)
+        LOG1LINE("processing in parts");
+    ok = ok && forkShards(Option, listLemmas, shards, &inside);
+    std::vector<char> buf(0x10000);
+    std::unordered_map<std::string, char> types;
+    for (size_t i = 0; i < shards.size() && ok; ++i)
+    {
+        rewind(shards[i].out);
+        size_t n;
+        while ((n = fread(&buf[0], 1, buf.size(), shards[i].out)) > 0)
+            fwrite(&buf[0], 1, n, fpout);
+
+        char line[2048];
+        unsigned long totcnt, newcnt, newhom, probes, rejects, cacheProbes, hits;
+        rewind(shards[i].results);
+        if (fgets(line, sizeof(line), shards[i].results) && sscanf(line, "%lu %lu %lu %lu %lu %lu %lu", &totcnt, &newcnt, &newhom, &probes, &rejects, &cacheProbes, &hits) == 7)
+        {
+            tally->totcnt += totcnt;
+            tally->newcnt += newcnt;
+            tally->newhom += newhom;
+            dictionary::addFilterStatistics(probes, rejects);
+            warmcache::addStatistics(cacheProbes, hits);
+        }
+        while (fgets(line, sizeof(line), shards[i].results))
+        {
+            line[strcspn(line, "\n")] = '\0';
+            if (line[0] && line[1] == '\t')
+                types.insert(std::make_pair(std::string(line + 2), line[0]));
+        }
+    }
+    if (ok)
+    {
+        if (Option.InputHasTags) // flattext only counts tagged types
+            tally->totcntTypes = types.size();
+        for (std::unordered_map<std::string, char>::const_iterator t = types.begin(); t != types.end(); ++t)
+        {
+            if (t->second == 'u')
+                ++tally->newcntTypes;
+            else if (t->second == 'c')
+                ++tally->newhomTypes;
+        }
+    }
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        if (shards[i].out)
+            fclose(shards[i].out);
+        if (shards[i].results)
+            fclose(shards[i].results);
+    }
+    munmap(image, size);
+    return ok;
+}
+#endif
+
 void Lemmatiser::LemmatiseText(FILE *fpin, FILE *fpout, tallyStruct *tally)
 {
     if (changed)
         setFormats();
+    dictionary::waitUntilReady();
+    text::SortThreads = Option.threads;
+    if (chunked())
+    {
+        if (nice)
+            LOG1LINE("processing in chunks");
+        LemmatiseChunks(fpin, fpout, tally);
+        return;
+    }
+#if !defined _WIN32
+    if (sharded() && LemmatiseShards(fpin, fpout, tally))
+        return;
+#endif
     text *Text;
     if (Option.XML)
     {
@@ -841,32 +1357,74 @@ int Lemmatiser::LemmatiseFile()
              "conflicting    %10.lu (%lu%%)",
              tally.totcntTypes, tally.newcntTypes, tally.totcntTypes ? (tally.newcntTypes * 200 + 1) / (2 * tally.totcntTypes) : 100UL, tally.newhomTypes, tally.totcntTypes ? (tally.newhomTypes * 200 + 1) / (2 * tally.totcntTypes) : 100UL);
 
+    unsigned long probes, rejects;
+    if (dictionary::filterStatistics(probes, rejects))
+        info("\ndictionary filter: %lu look-ups, %lu (%lu%%) rejected", probes, rejects, probes ? (rejects * 200 + 1) / (2 * probes) : 0UL);
+
+    tdictmemory mem;
+    if (dictionary::memory(mem))
+        info("\ndictionary memory: %lu KB%s (strings %lu, readings %lu, nodes %lu, trie %lu, filter %lu, delta %lu)",
+             (unsigned long)((mem.strings + mem.readings + mem.nodes + mem.trie + mem.filter + mem.delta + 1023) / 1024),
+             mem.mapped ? " mapped" : "",
+             (unsigned long)mem.strings, (unsigned long)mem.readings, (unsigned long)mem.nodes,
+             (unsigned long)mem.trie, (unsigned long)mem.filter, (unsigned long)mem.delta);
+
+    unsigned long hits;
+    if (warmcache::statistics(probes, hits))
+        info("\nwarm cache: %lu look-ups, %lu (%lu%%) hits", probes, hits, probes ? (hits * 200 + 1) / (2 * probes) : 0UL);
+
+    if (Option.warmcacheout && saveWarmCache(Option.warmcacheout, Option.warmsize))
+        info("-M\t%-20s\tWarm cache written", Option.warmcacheout);
+
     return 0;
 }
 
-string Lemmatiser::LemmatiseString(string str)
+bool Lemmatiser::dictionaryReady()
+{
+    return dictionary::poll();
+}
+
+bool Lemmatiser::waitUntilReady()
+{
+    return dictionary::waitUntilReady();
+}
+
+/* If dictConsulted is not NULL, it tells whether the dictionary was used.
+   (With -a, it is not used until it is loaded.) */
+string Lemmatiser::LemmatiseString(string str, bool *dictConsulted)
 {
     string result;
+    bool ready = dictionary::poll();
+    if (dictConsulted)
+        *dictConsulted = ready;
 
     tallyStruct tally;
 
-    text *Text;
-
-    Text = new flattext(str, 1, nice, ULONG_MAX, false);
+    /* The text and its arrays are kept from call to call, which saves
+       allocating and freeing them for every string. */
+    if (session)
+        session->clear(Option.keep);
+    else
+        session = new flattext(nice);
+    session->read(str, 1, nice, ULONG_MAX, false);
     
     if (nice)
         LOG1LINE("processing");
     
-    result = Text->Lemmatise("|", &tally, 0, 2, nice, false, false, caseTp::easis, listLemmas, false);
-    delete Text;
+    result = session->Lemmatise("|", &tally, 0, 2, nice, false, false, caseTp::easis, listLemmas, false);
 
     return result;
 }
 
 void Lemmatiser::LemmatiseEnd()
 {
+    delete session;
+    session = 0;
+    warmcache::clear();
     delete TextToDictTags;
     delete TagFriends;
+    dict.close(); // before the bundle that it may point into
+    bundle::close();
 }
 
 #endif
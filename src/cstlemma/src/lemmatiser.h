@@ -25,9 +25,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #endif
 
 #include <string>
+#include <unordered_set>
 
 #if defined PROGLEMMATISE
 class tagpairs;
+class flattext;
 #endif
 
 struct optionStruct;
@@ -50,6 +52,7 @@ private:
 #if (defined PROGLEMMATISE)
         dictionary dict;
         static tagpairs *TextToDictTags;
+        flattext *session; // reused by LemmatiseString
 #endif
         int listLemmas;
         int status;
@@ -68,17 +71,34 @@ public:
 #if defined PROGLEMMATISE
         static const char *translate(const char *tag);
         int setFormats();
+        int openBundle();
         int openFiles();
         void showSwitches();
+        bool chunked();
+        void LemmatiseChunks(FILE *fpin, FILE *fpout, tallyStruct *tally);
+        void readChunks(FILE *fpin, FILE *fpout, tallyStruct *tally, std::unordered_set<std::string> *inside);
+        bool sharded();
+        bool LemmatiseShards(FILE *fpin, FILE *fpout, tallyStruct *tally);
         void LemmatiseText(FILE *fpin, FILE *fpout, tallyStruct *tally);
 
         int LemmatiseFile();
         int LemmatiseInit();
-        std::string LemmatiseString(std::string str);
+        std::string LemmatiseString(std::string str, bool *dictConsulted = NULL);
+        bool dictionaryReady();
+        bool waitUntilReady();
+        bool loadWarmCache(const char *filename);
+        void recordTraffic(size_t ntypes);
+        bool saveWarmCache(const char *filename, size_t ntypes);
         void LemmatiseEnd();
 #endif
 #if defined PROGMAKEDICT
         int MakeDict();
+#if defined PROGLEMMATISE
+        int MergeDict();
+#endif
+#endif
+#if defined PROGLEMMATISE
+        int MakeBundle();
 #endif
 #if defined PROGMAKESUFFIXFLEX
         int MakeFlexPatterns();
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if defined PROGLEMMATISE
 
 #include "caseconv.h"
+#include "tags.h"
 #if STREAM
 #include <iostream>
 using namespace std;
@@ -37,19 +38,23 @@ char ** fullTags = NULL; //List of tags that may occur in the text  (e.g. V_MED_
 char ** lemmaTags = NULL; //List of tags of the corresponding lemmata (e.g. V_MED)
 // tags that occur in the text as well as in the dictionary are not listed.
 int fulltagcnt = 0;
+static int * lemmaTagOf = NULL; // tag ID -> first f with fullTags[f] equal to tag, or -1
+static int nlemmaTagOf = 0;
 
 const char * LemmaTag(const char * tag)
     {
-    int f;
-    for(f = 0;f < fulltagcnt;++f)
+    if(fulltagcnt)
         {
-        if(!strcmp(tag,fullTags[f]))
-            break;
+        int id = tagregistry::find(tag);
+        if(0 <= id && id < nlemmaTagOf && lemmaTagOf[id] >= 0)
+            return lemmaTags[lemmaTagOf[id]];
         }
-    if(f < fulltagcnt)
-        return lemmaTags[f];
-    else
-        return tag;
+    return tag;
+    }
+
+bool hasLemmaTags()
+    {
+    return fulltagcnt > 0;
     }
 
 static bool taglinecheck(const char * xx)
@@ -157,6 +162,16 @@ bool readLemmaTags(FILE * fpx,bool nice)
             ++fulltagcnt;
             }
         }
+    int f;
+    for(f = 0;f < fulltagcnt;++f)
+        tagregistry::add(fullTags[f]);
+    delete [] lemmaTagOf;
+    nlemmaTagOf = tagregistry::count();
+    lemmaTagOf = new int[nlemmaTagOf];
+    for(f = 0;f < nlemmaTagOf;++f)
+        lemmaTagOf[f] = -1;
+    for(f = fulltagcnt;--f >= 0;) // backwards: the first occurrence wins
+        lemmaTagOf[tagregistry::find(fullTags[f])] = f;
     if(nice)
         {
         printf("\n");
@@ -29,6 +29,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 bool readLemmaTags(FILE * fpx,bool nice);
 const char * LemmaTag(const char * tag);
+bool hasLemmaTags();
 
 #endif
 #endif
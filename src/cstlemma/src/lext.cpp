@@ -30,6 +30,7 @@ int lext::COUNT = 0;
 #endif
 
 caseTp lext::baseformsAreLowercase = caseTp::easis;
+const char * lext::Strings = "";
 
 const char * lext::constructBaseform(const char * fullform) const
     {
@@ -50,7 +51,7 @@ const char * lext::constructBaseform(const char * fullform) const
             }
         pbuf = buf + strlen(buf);
         }
-    for(w = BaseFormSuffix;*w;)
+    for(w = BaseFormSuffix();*w;)
         {
         *pbuf++ = *w++;
         }
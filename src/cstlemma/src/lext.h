@@ -52,9 +52,19 @@ struct lext
         --COUNT;
         }
 #endif
-    char * Type;
-    char * BaseFormSuffix;
+    static const char * Strings; // The dictionary's string pool
+    tindex iType; // index into Strings. Equal types have equal indices, see
+                  // tagregistry::dictType
+    tindex iBaseFormSuffix; // index into Strings
     tsundry S;
+    const char * Type() const
+        {
+        return Strings + iType;
+        }
+    const char * BaseFormSuffix() const
+        {
+        return Strings + iBaseFormSuffix;
+        }
     const char * constructBaseform(const char * fullform) const;
     /*
     Construct lemma by taking the first Offset characters from fullform and 
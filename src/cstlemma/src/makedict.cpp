@@ -28,6 +28,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "readfreq.h"
 #include "caseconv.h"
 #include "utf8func.h"
+#include "bloomfilter.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -43,6 +44,13 @@ using namespace std;
 
 class DictNode;
 class Lemma;
+
+typedef struct
+    { // Record in DS_LEXT section. Same layout as struct lext in lext.h
+    tindex Type;
+    tindex BaseFormSuffix;
+    tsundry S;
+    } tlextrec;
 typedef int tchildrencount; // type for variables that are optimal for counting
                             // small numbers, but the value of which eventually
                             // will be typecasted to tchildren.
@@ -308,6 +316,12 @@ public:
         fwrite(&tmp,sizeof(tmp),1,fp);
         fwrite(&S,sizeof(S),1,fp);
         }
+    void record(tlextrec & rec)
+        {
+        rec.Type = Type == nul ? 0 : (tindex)(Type - STRINGS0);
+        rec.BaseFormSuffix = BaseForm == nul ? 0 : (tindex)(BaseForm - STRINGS0);
+        rec.S = S;
+        }
     };
 
 enum class Case {casesensitive,caseinsensitive};
@@ -501,6 +515,7 @@ public:
     void BreadthFirst_print(size_t indent,tchildrencount length,FILE * fp);
     void BreadthFirst_print(size_t indent,tchildrencount length,FILE * fp,char * wrd);
     void BreadthFirst_printBin(FILE * fp);
+    tcount layout(tcount at,tcount curr,tindex * strs,tchildren * nchildren,tindex * pos);
     void print(size_t indent,FILE * fp);
     void print(size_t indent,FILE * fp,char * wrd);
     int printLeaf()
@@ -838,6 +853,33 @@ void DictNode::BreadthFirst_printBin(FILE * fp)
         }
     }
 
+/*
+Put the nodes in the order in which dictionary::readStretch would put them,
+which is the order of the arrays in a memory mappable dictionary:
+this node and its siblings at positions [at, at+length) followed by the
+descendants of the first sibling, the descendants of the second sibling, etc.
+*/
+tcount DictNode::layout(tcount at,tcount curr,tindex * strs,tchildren * nchildren,tindex * pos)
+    {
+    DictNode * nxt;
+    tcount i;
+    for(nxt = this,i = at;nxt;nxt = nxt->next,++i)
+        {
+        strs[i] = nxt->m_flexform == nul ? 0 : (tindex)(nxt->m_flexform - STRINGS0);
+        nchildren[i] = tchildren(nxt->m_n);
+        pos[i] = nxt->leaf ? (tindex)(nxt->u.type - LEMMAS) : -1;
+        }
+    for(nxt = this,i = at;nxt;nxt = nxt->next,++i)
+        {
+        if(!nxt->leaf)
+            {
+            pos[i] = -curr;
+            curr = nxt->u.sub->layout(curr,curr + nxt->m_n,strs,nchildren,pos);
+            }
+        }
+    return curr;
+    }
+
 void DictNode::print(size_t indent,FILE * fp,char * wrd)
     {
     size_t len = strlen(wrd); 
@@ -1086,7 +1128,547 @@ static tcount compressLeafs(tcount nLeaf,tcount * nUniqueLemmas)
     return len;
     }
     
-int makedict(FILE * fpin,FILE * fpout,bool nice,const char * format,const FreqFile * freq,bool CollapseHomographs)
+/*
+Double-array trie over the full forms. See lem.h.
+*/
+typedef struct
+    {
+    char * fullform;
+    tindex leaf; // index of leaf node
+    } tdakey;
+
+static tdakey * DAKEYS = NULL;
+static tcount nDAKEYS = 0;
+static INT32 * DABASE = NULL;
+static INT32 * DACHECK = NULL; // -1: free
+static tcount DACAPACITY = 0;
+static tcount DASIZE = 0; // number of used positions, including trailing free ones
+static tcount DAFREE = 1; // no free positions below DAFREE
+
+static tcount countLeafs(const tindex * pos,const tchildren * nchildren,tcount at,int n)
+    {
+    tcount ret = 0;
+    for(tcount i = at;i < at + n;++i)
+        ret += pos[i] >= 0 ? 1 : countLeafs(pos,nchildren,-pos[i],nchildren[i]);
+    return ret;
+    }
+
+static void collectFullforms(const tindex * strs,const tindex * pos,const tchildren * nchildren,tcount at,int n,const char * head)
+    {
+    size_t len = strlen(head);
+    for(tcount i = at;i < at + n;++i)
+        {
+        const char * s = strs[i] ? STRINGS0 + strs[i] : nul;
+        char * fullform = new char[len + strlen(s) + 1];
+        strcpy(fullform,head);
+        strcpy(fullform + len,s);
+        if(pos[i] >= 0)
+            {
+            DAKEYS[nDAKEYS].fullform = fullform;
+            DAKEYS[nDAKEYS++].leaf = (tindex)i;
+            }
+        else
+            {
+            collectFullforms(strs,pos,nchildren,-pos[i],nchildren[i],fullform);
+            delete [] fullform;
+            }
+        }
+    }
+
+static int compareDAKey(const void * arg1, const void * arg2)
+    {
+    return strcmp(((const tdakey *)arg1)->fullform,((const tdakey *)arg2)->fullform);
+    }
+
+static void DAreserve(tcount size)
+    {
+    if(size > DACAPACITY)
+        {
+        tcount capacity = DACAPACITY ? DACAPACITY : 1024;
+        while(capacity < size)
+            capacity *= 2;
+        INT32 * base = new INT32[capacity];
+        INT32 * check = new INT32[capacity];
+        if(DACAPACITY)
+            {
+            memcpy(base,DABASE,DACAPACITY * sizeof(INT32));
+            memcpy(check,DACHECK,DACAPACITY * sizeof(INT32));
+            }
+        for(tcount i = DACAPACITY;i < capacity;++i)
+            {
+            base[i] = 0;
+            check[i] = -1;
+            }
+        delete [] DABASE;
+        delete [] DACHECK;
+        DABASE = base;
+        DACHECK = check;
+        DACAPACITY = capacity;
+        }
+    if(size > DASIZE)
+        DASIZE = size;
+    }
+
+static int DAcode(const char * fullform,size_t depth)
+    {
+    return fullform[depth] ? (unsigned char)fullform[depth] + 1 : 0;
+    }
+
+/* Give state the transitions needed for the keys [lo,hi), which have the
+   first depth bytes in common. */
+static void DAinsert(tcount state,tcount lo,tcount hi,size_t depth)
+    {
+    int codes[257];
+    tcount starts[258];
+    int ncodes = 0;
+    for(tcount k = lo;k < hi;++k)
+        {
+        int code = DAcode(DAKEYS[k].fullform,depth);
+        if(ncodes == 0 || codes[ncodes - 1] != code)
+            {
+            codes[ncodes] = code;
+            starts[ncodes++] = k;
+            }
+        }
+    starts[ncodes] = hi;
+    tcount base = DAFREE - codes[0];
+    if(base < 1)
+        base = 1;
+    for(;;++base)
+        {
+        DAreserve(base + codes[ncodes - 1] + 1);
+        int j;
+        for(j = 0;j < ncodes && DACHECK[base + codes[j]] == -1;++j)
+            ;
+        if(j == ncodes)
+            break;
+        }
+    DABASE[state] = (INT32)base;
+    int j;
+    for(j = 0;j < ncodes;++j)
+        DACHECK[base + codes[j]] = (INT32)state;
+    while(DAFREE < DASIZE && DACHECK[DAFREE] != -1)
+        ++DAFREE;
+    for(j = 0;j < ncodes;++j)
+        {
+        if(codes[j] == 0) // end of full form. Full forms are unique.
+            DABASE[base] = -DAKEYS[starts[j]].leaf - 1;
+        else
+            DAinsert(base + codes[j],starts[j],starts[j + 1],depth + 1);
+        }
+    }
+
+static void buildDoubleArray(const tindex * strs,const tindex * pos,const tchildren * nchildren,tchildrencount nroot)
+    {
+    LOG1LINE("building double-array trie");
+    DAKEYS = new tdakey[countLeafs(pos,nchildren,0,nroot)];
+    nDAKEYS = 0;
+    collectFullforms(strs,pos,nchildren,0,nroot,"");
+    qsort(DAKEYS,nDAKEYS,sizeof(tdakey),compareDAKey);
+    DAreserve(1);
+    DACHECK[0] = 0; // root
+    DAFREE = 1;
+    if(nDAKEYS > 0)
+        DAinsert(0,0,nDAKEYS,0);
+    for(tcount k = 0;k < nDAKEYS;++k)
+        delete [] DAKEYS[k].fullform;
+    delete [] DAKEYS;
+    DAKEYS = NULL;
+#if STREAM
+    cout << "double-array trie has " << DASIZE << " positions for " << nDAKEYS << " full forms" << endl;
+#else
+    printf("double-array trie has " PERCLD " positions for " PERCLD " full forms\n",DASIZE,nDAKEYS);
+#endif
+    }
+
+/* Compute the DS_LEAFINFO record of each full form with more than one
+   reading, mirroring Word::maxFrequency, Word::commonType and
+   Word::commonStem. */
+static tleafinfo * makeLeafInfo(const char * strs,const tlextrec * lexts,tcount nlext,const tindex * pos,const tchildren * nchildren,tcount nnodes)
+    {
+    tleafinfo * info = new tleafinfo[nlext];
+    memset(info,0,nlext * sizeof(tleafinfo));
+    for(tcount i = 0;i < nnodes;++i)
+        {
+        int nmbr = nchildren[i];
+        if(pos[i] < 0 || nmbr < 2)
+            continue;
+        const tlextrec * plext = lexts + pos[i];
+        tleafinfo & rec = info[pos[i]];
+        unsigned int maxfreq = 0;
+        int n = 1;
+        int j;
+        for(j = 0;j < nmbr;++j)
+            {
+            if(plext[j].S.frequency > maxfreq)
+                {
+                n = 1;
+                maxfreq = plext[j].S.frequency;
+                }
+            else if(plext[j].S.frequency == maxfreq)
+                ++n;
+            }
+        rec.S.frequency = maxfreq;
+        rec.nmax = n;
+        // As in Word::commonType and Word::commonStem, an empty string does
+        // not fix the common string.
+        rec.iType = -1;
+        for(j = 0;j < nmbr;++j)
+            {
+            if(plext[j].S.frequency == maxfreq)
+                {
+                if(rec.iType < 0 || !strs[rec.iType])
+                    rec.iType = plext[j].Type;
+                else if(strcmp(strs + rec.iType,strs + plext[j].Type))
+                    {
+                    rec.iType = -1;
+                    break;
+                    }
+                }
+            }
+        // As in Word::commonStem, only the readings of the common type
+        // count, also if that type is empty.
+        tindex suffix = -1;
+        unsigned int off = 0;
+        for(j = 0;j < nmbr;++j)
+            {
+            if(  plext[j].S.frequency == maxfreq
+              && (rec.iType < 0 || !strcmp(strs + rec.iType,strs + plext[j].Type))
+              )
+                {
+                if(suffix >= 0 && off != plext[j].S.Offset)
+                    break;
+                const char * bf = strs + plext[j].BaseFormSuffix;
+                if(suffix >= 0 && strs[suffix])
+                    {
+                    if(strcmp(strs + suffix,bf))
+                        break;
+                    }
+                else
+                    {
+                    suffix = plext[j].BaseFormSuffix;
+                    off = plext[j].S.Offset;
+                    }
+                }
+            }
+        if(j < nmbr)
+            suffix = -1;
+        rec.iStemSuffix = suffix;
+        rec.S.Offset = suffix >= 0 ? off : 0;
+        }
+    return info;
+    }
+
+static int compareTindex(const void * arg1,const void * arg2)
+    {
+    tindex a = *(const tindex *)arg1;
+    tindex b = *(const tindex *)arg2;
+    return a < b ? -1 : a > b ? 1 : 0;
+    }
+
+/* Collect the distinct types in lexts (section DS_TYPES). */
+static tindex * makeTypes(const tlextrec * lexts,tcount nlext,tcount & ntypes)
+    {
+    tindex * types = new tindex[nlext > 0 ? nlext : 1];
+    tcount i;
+    for(i = 0;i < nlext;++i)
+        types[i] = lexts[i].Type;
+    qsort(types,nlext,sizeof(tindex),compareTindex);
+    ntypes = 0;
+    for(i = 0;i < nlext;++i)
+        if(ntypes == 0 || types[ntypes - 1] != types[i])
+            types[ntypes++] = types[i];
+    return types;
+    }
+
+static const char * SORTSTRS = NULL; // string pool for compareString
+
+static int compareString(const void * arg1,const void * arg2)
+    {
+    return strcmp(SORTSTRS + *(const tindex *)arg1,SORTSTRS + *(const tindex *)arg2);
+    }
+
+/* Sorted, distinct copy of the n indices in idx. */
+static tindex * distinct(const tindex * idx,tcount n,tcount & ndistinct,int (*cmp)(const void *,const void *))
+    {
+    tindex * ret = new tindex[n > 0 ? n : 1];
+    memcpy(ret,idx,n * sizeof(tindex));
+    qsort(ret,n,sizeof(tindex),cmp);
+    ndistinct = 0;
+    for(tcount i = 0;i < n;++i)
+        if(ndistinct == 0 || ret[ndistinct - 1] != ret[i])
+            ret[ndistinct++] = ret[i];
+    return ret;
+    }
+
+/* Front code the node strings (section DS_FCSTRINGS) and replace the
+   indices in nodestrings by string numbers. Returns NULL if a node string
+   is too long. */
+static char * frontCode(const char * strs,tindex * nodestrings,tcount nnodes,size_t & size)
+    {
+    SORTSTRS = strs;
+    tcount nstrings;
+    tindex * sorted = distinct(nodestrings,nnodes,nstrings,compareString);
+    tcount i;
+    size_t datasize = 0;
+    for(i = 0;i < nstrings;++i)
+        {
+        const char * s = strs + sorted[i];
+        size_t len = strlen(s);
+        if(len >= DICTFCMAXSTRING)
+            {
+            delete [] sorted;
+            return NULL;
+            }
+        if(i % DICTFCBLOCK == 0)
+            datasize += len + 1;
+        else
+            {
+            const char * prev = strs + sorted[i - 1];
+            size_t shared = 0;
+            while(s[shared] && s[shared] == prev[shared])
+                ++shared;
+            datasize += 1 + len - shared + 1;
+            }
+        }
+    tcount nblocks = (nstrings + DICTFCBLOCK - 1) / DICTFCBLOCK;
+    size_t headsize = sizeof(tfcheader) + nblocks * sizeof(INT32);
+    size = headsize + datasize;
+    char * image = new char[size];
+    tfcheader header;
+    header.nstrings = (INT32)nstrings;
+    header.blocksize = DICTFCBLOCK;
+    memcpy(image,&header,sizeof(header));
+    INT32 * blockoffset = (INT32 *)(image + sizeof(header));
+    char * data = image + headsize;
+    char * d = data;
+    for(i = 0;i < nstrings;++i)
+        {
+        const char * s = strs + sorted[i];
+        if(i % DICTFCBLOCK == 0)
+            blockoffset[i / DICTFCBLOCK] = (INT32)(d - data);
+        else
+            {
+            const char * prev = strs + sorted[i - 1];
+            size_t shared = 0;
+            while(s[shared] && s[shared] == prev[shared])
+                ++shared;
+            *d++ = (char)shared;
+            s += shared;
+            }
+        size_t len = strlen(s);
+        memcpy(d,s,len + 1);
+        d += len + 1;
+        }
+    for(i = 0;i < nnodes;++i)
+        {
+        const tindex * found = (const tindex *)bsearch(nodestrings + i,sorted,nstrings,sizeof(tindex),compareString);
+        nodestrings[i] = (tindex)(found - sorted);
+        }
+    delete [] sorted;
+    return image;
+    }
+
+/* Number of k in sorted[0,n). */
+static tindex renumber(const tindex * sorted,tcount n,tindex k)
+    {
+    const tindex * found = (const tindex *)bsearch(&k,sorted,n,sizeof(tindex),compareTindex);
+    return (tindex)(found - sorted);
+    }
+
+/* Make a string pool (the new DS_STRINGS) with only the strings that the
+   lext records refer to and renumber lexts, leafinfo and types. */
+static char * lextStrings(const char * strs,tlextrec * lexts,tcount nlext,tleafinfo * leafinfo,tindex * types,tcount ntypes,size_t & size)
+    {
+    tindex * idx = new tindex[2 * nlext + 1];
+    tcount i;
+    idx[0] = 0; // the empty string
+    for(i = 0;i < nlext;++i)
+        {
+        idx[2 * i + 1] = lexts[i].Type;
+        idx[2 * i + 2] = lexts[i].BaseFormSuffix;
+        }
+    tcount nidx;
+    tindex * sorted = distinct(idx,2 * nlext + 1,nidx,compareTindex);
+    delete [] idx;
+    tindex * newidx = new tindex[nidx];
+    size = 0;
+    for(i = 0;i < nidx;++i)
+        {
+        newidx[i] = (tindex)size;
+        size += sorted[i] ? strlen(strs + sorted[i]) + 1 : 1;
+        }
+    char * pool = new char[size];
+    for(i = 0;i < nidx;++i)
+        strcpy(pool + newidx[i],strs + sorted[i]);
+    for(i = 0;i < nlext;++i)
+        {
+        lexts[i].Type = newidx[renumber(sorted,nidx,lexts[i].Type)];
+        lexts[i].BaseFormSuffix = newidx[renumber(sorted,nidx,lexts[i].BaseFormSuffix)];
+        if(leafinfo[i].iType > 0)
+            leafinfo[i].iType = newidx[renumber(sorted,nidx,leafinfo[i].iType)];
+        if(leafinfo[i].iStemSuffix > 0)
+            leafinfo[i].iStemSuffix = newidx[renumber(sorted,nidx,leafinfo[i].iStemSuffix)];
+        }
+    for(i = 0;i < ntypes;++i)
+        types[i] = newidx[renumber(sorted,nidx,types[i])];
+    delete [] sorted;
+    delete [] newidx;
+    return pool;
+    }
+
+static tcount align(tcount offset)
+    {
+    return (offset + DICTALIGN - 1) / DICTALIGN * DICTALIGN;
+    }
+
+/*
+Write memory mappable dictionary (format version 2). See lem.h.
+*/
+static void writeImage(FILE * fpout,tlength stringBufferLen,tcount LemmaBufferLen,tcount nnodes,tchildrencount nroot,bool DoubleArray,bool FrontCoded,double BloomRate)
+    {
+    char * strs = new char[stringBufferLen + 1];
+    strs[0] = '\0';
+    memcpy(strs + 1,STRINGS,stringBufferLen);
+
+    tlextrec * lexts = new tlextrec[LemmaBufferLen];
+    memset(lexts,0,LemmaBufferLen * sizeof(tlextrec)); // also padding
+    tcount i;
+    for(i = 0;i < LemmaBufferLen;++i)
+        LEMMAS[i].record(lexts[i]);
+
+    tindex * nodestrings = new tindex[nnodes];
+    tchildren * nchildren = new tchildren[nnodes];
+    tindex * pos = new tindex[nnodes];
+    root->layout(0,nroot,nodestrings,nchildren,pos);
+
+    INT32 * initialchars = new INT32[nnodes];
+    bool UTF8 = true; // As in dictionary::readNodes
+    for(i = 0;i < nnodes;++i)
+        initialchars[i] = UTF8char(nodestrings[i] ? STRINGS0 + nodestrings[i] : nul,UTF8);
+
+    const void * data[DICTMAXSECTIONS];
+    size_t size[DICTMAXSECTIONS];
+    memset(size,0,sizeof(size));
+    data[DS_STRINGS] = strs;
+    size[DS_STRINGS] = stringBufferLen + 1;
+    data[DS_LEXT] = lexts;
+    size[DS_LEXT] = LemmaBufferLen * sizeof(tlextrec);
+    data[DS_INITIALCHARS] = initialchars;
+    size[DS_INITIALCHARS] = nnodes * sizeof(INT32);
+    data[DS_NODESTRINGS] = nodestrings;
+    size[DS_NODESTRINGS] = nnodes * sizeof(tindex);
+    data[DS_POS] = pos;
+    size[DS_POS] = nnodes * sizeof(tindex);
+    data[DS_NUMBEROFCHILDREN] = nchildren;
+    size[DS_NUMBEROFCHILDREN] = nnodes * sizeof(tchildren);
+    if(DoubleArray)
+        {
+        buildDoubleArray(nodestrings,pos,nchildren,nroot);
+        data[DS_DABASE] = DABASE;
+        size[DS_DABASE] = DASIZE * sizeof(INT32);
+        data[DS_DACHECK] = DACHECK;
+        size[DS_DACHECK] = DASIZE * sizeof(INT32);
+        }
+    tleafinfo * leafinfo = makeLeafInfo(strs,lexts,LemmaBufferLen,pos,nchildren,nnodes);
+    data[DS_LEAFINFO] = leafinfo;
+    size[DS_LEAFINFO] = LemmaBufferLen * sizeof(tleafinfo);
+    tcount ntypes;
+    tindex * types = makeTypes(lexts,LemmaBufferLen,ntypes);
+    data[DS_TYPES] = types;
+    size[DS_TYPES] = ntypes * sizeof(tindex);
+    char * bloom = NULL;
+    if(BloomRate > 0.0)
+        {
+        bloomfilter filter(countLeafs(pos,nchildren,0,nroot),BloomRate);
+        if(filter.valid())
+            {
+            filter.addFullforms(strs,nodestrings,pos,nchildren,0,nroot,BLOOMHASHINIT);
+            bloom = new char[filter.imageSize()];
+            filter.writeImage(bloom);
+            data[DS_BLOOM] = bloom;
+            size[DS_BLOOM] = filter.imageSize();
+            }
+        }
+
+    char * fcstrings = NULL;
+    char * lextstrings = NULL;
+    if(FrontCoded) // Must be last: changes nodestrings and lexts.
+        {
+        size_t fcsize;
+        fcstrings = frontCode(strs,nodestrings,nnodes,fcsize);
+        if(fcstrings)
+            {
+            size_t lextsize;
+            lextstrings = lextStrings(strs,lexts,LemmaBufferLen,leafinfo,types,ntypes,lextsize);
+            data[DS_STRINGS] = lextstrings;
+            size[DS_STRINGS] = lextsize;
+            data[DS_FCSTRINGS] = fcstrings;
+            size[DS_FCSTRINGS] = fcsize;
+#if STREAM
+            cout << "string pool: " << stringBufferLen + 1 << " bytes, front coded: " << fcsize + lextsize << " bytes" << endl;
+#else
+            printf("string pool: %lu bytes, front coded: %lu bytes\n",(unsigned long)(stringBufferLen + 1),(unsigned long)(fcsize + lextsize));
+#endif
+            }
+        else
+            LOG1LINE("node string too long for front coding, string pool is not compressed");
+        }
+
+    tdictheader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,DICTMAGIC,sizeof(header.magic));
+    header.version = DICTVERSION;
+    header.byteorder = DICTBYTEORDER;
+    header.sizeofindex = sizeof(tindex);
+    header.sizeoflext = sizeof(tlextrec);
+    header.utf8 = UTF8 ? 1 : 0;
+    header.ntoplevel = tchildren(nroot);
+    header.nnodes = nnodes;
+    header.nlext = LemmaBufferLen;
+    tcount offset = align(sizeof(header));
+    int sec;
+    for(sec = 0;sec < DICTMAXSECTIONS;++sec)
+        {
+        if(size[sec])
+            {
+            header.section[sec].offset = offset;
+            header.section[sec].size = (tcount)size[sec];
+            offset = align(offset + (tcount)size[sec]);
+            }
+        }
+    fwrite(&header,sizeof(header),1,fpout);
+    tcount written = sizeof(header);
+    static const char zeros[DICTALIGN] = {0};
+    for(sec = 0;sec < DICTMAXSECTIONS;++sec)
+        {
+        if(size[sec])
+            {
+            fwrite(zeros,1,header.section[sec].offset - written,fpout);
+            fwrite(data[sec],size[sec],1,fpout);
+            written = header.section[sec].offset + header.section[sec].size;
+            }
+        }
+    delete [] strs;
+    delete [] lexts;
+    delete [] nodestrings;
+    delete [] nchildren;
+    delete [] pos;
+    delete [] initialchars;
+    delete [] bloom;
+    delete [] leafinfo;
+    delete [] types;
+    delete [] fcstrings;
+    delete [] lextstrings;
+    delete [] DABASE;
+    delete [] DACHECK;
+    DABASE = DACHECK = NULL;
+    DACAPACITY = DASIZE = 0;
+    }
+
+/* fpfreq: (optional) frequencies in format NFBT, e.g. written by
+   dictionary::dump */
+int makedict(FILE * fpin,FILE * fpout,bool nice,const char * format,const FreqFile * freq,bool CollapseHomographs,int DictVersion,bool DoubleArray,bool FrontCoded,double BloomRate,FILE * fpfreq)
     {
     root = new DictNode("","","",0);
 #if STREAM
@@ -1106,6 +1688,8 @@ int makedict(FILE * fpin,FILE * fpout,bool nice,const char * format,const FreqFi
 #endif
     if(failed)
         LOG1LINE("(see file \"discarded\")");
+    if(fpfreq)
+        readFrequencies(fpfreq,"NFBT",addFreq,T);
     while(freq)
         {
         if(!freq->itsName())
@@ -1171,7 +1755,7 @@ int makedict(FILE * fpin,FILE * fpout,bool nice,const char * format,const FreqFi
             fprintf(fpout,PERCLD " " PERCLD " %s\n",i,(tindex)(strings[i] - STRINGS),strings[i]);
             }
         }
-    else
+    else if(DictVersion < 2)
         {
         fwrite(&stringBufferLen,sizeof(stringBufferLen),1,fpout);
         fwrite(STRINGS,stringBufferLen,1,fpout);
@@ -1187,7 +1771,7 @@ int makedict(FILE * fpin,FILE * fpout,bool nice,const char * format,const FreqFi
             fprintf(fpout,"\n");
             }
         }
-    else
+    else if(DictVersion < 2)
         {
         fwrite(&LemmaBufferLen,sizeof(LemmaBufferLen),1,fpout);
         for(i = 0;i < LemmaBufferLen;++i)
@@ -1207,13 +1791,17 @@ int makedict(FILE * fpin,FILE * fpout,bool nice,const char * format,const FreqFi
         fprintf(fpout,"*** nodes ***\n" PERCLD "\n",nnodes);
         root->BreadthFirst_print(0,nroot,fpout);
         }
-    else
+    else if(DictVersion < 2)
         {
         fwrite(&nnodes,sizeof(nnodes),1,fpout);
         tchildren nrootwrite = (tchildren)nroot;
         fwrite(&nrootwrite,sizeof(nrootwrite),1,fpout);
         root->BreadthFirst_printBin(fpout);
         }
+    else
+        {
+        writeImage(fpout,stringBufferLen,LemmaBufferLen,nnodes,nroot,DoubleArray,FrontCoded,BloomRate);
+        }
 
     delete root;
     delete [] strings;
@@ -22,8 +22,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "option.h"
 #if (defined PROGLEMMATISE) || (defined PROGMAKEDICT)
+#include "lem.h"
 #include "freqfile.h"
 #endif
+#if defined PROGLEMMATISE
+#include "warmcache.h"
+#endif
 #include "caseconv.h"
 #include "argopt.h"
 #include <limits.h>
@@ -56,7 +60,7 @@ const char optionStruct::Default_b_format[] = "$w";
 const char * optionStruct::Default_B_format = optionStruct::Default_b_format;
 #endif
 
-static char opts[] = "?@:A:b:B:c:C:d:De:f:F:H:hi:I:k:l:Lm:n:N:o:p:q:R:s:t:u:U:v:W:x:X:y:z:" /* GNU: */ "wr";
+static char opts[] = "?@:a:A:b:B:c:C:d:De:f:F:G:H:hi:I:j:J:k:K:l:LM:m:n:N:o:O:p:P:q:Q:R:s:S:t:T:u:U:v:W:x:X:y:z:Z" /* GNU: */ "wr";
 static char *** Ppoptions = NULL;
 static char ** Poptions = NULL;
 static int optionSets = 0;
@@ -74,6 +78,11 @@ optionStruct::optionStruct()
     defaultBformat = true;
     defaultCformat = true;
     dictfile = NULL;
+    delta = NULL;
+    AsyncDict = false;
+    warmcache = NULL;
+    warmcacheout = NULL;
+    warmsize = WARMDEFAULTSIZE;
     v = NULL;
     x = NULL;
     XML = false;
@@ -97,6 +106,10 @@ optionStruct::optionStruct()
     nice = false;
     CollapseHomographs = true;
     freq = NULL;
+    DictVersion = 1;
+    DoubleArray = false;
+    FrontCoded = false;
+    BloomRate = 0.0;
     Wformat = NULL;
     bformat = NULL;//dupl(Default_b_format);
     Bformat = NULL;//dupl(Default_B_format);
@@ -108,6 +121,10 @@ optionStruct::optionStruct()
     UseLemmaFreqForDisambiguation = 2;
     baseformsAreLowercase = caseTp::easis;
     size = ULONG_MAX;
+    chunk = 0;
+    jobs = 1;
+    threads = 1;
+    keep = 0x10000;
     treatSlashAsAlternativesSeparator = false;
     showRefcount = false;
     CutoffRefcount = 0;
@@ -141,6 +158,9 @@ optionStruct::~optionStruct()
     delete[] argi;
     delete[] argo;
     delete[] dictfile;
+    delete[] delta;
+    delete[] warmcache;
+    delete[] warmcacheout;
     delete[] flx;
     delete[] v;
     delete[] x;
@@ -179,6 +199,9 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
             readOptsFromFile(locoptarg,progname);
             break;
 #if defined PROGLEMMATISE
+        case 'a':
+            AsyncDict = locoptarg == NULL || *locoptarg != '-';
+            break;
         case 'A':
             if(locoptarg && *locoptarg == '-')
                 {
@@ -262,6 +285,25 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
                 }
             whattodo = whattodoTp::MAKEFLEXPATTERNS;
             break;
+#if defined PROGMAKEDICT
+        case 'G':
+            {
+            char * rest = NULL;
+            DictVersion = locoptarg ? strtol(locoptarg,&rest,10) : DICTVERSION;
+            DoubleArray = rest && strchr(rest,'t');
+            FrontCoded = rest && strchr(rest,'f');
+            if(  DictVersion < 1 
+              || DictVersion > DICTVERSION 
+              || (rest && rest[strspn(rest,"tf")])
+              || ((DoubleArray || FrontCoded) && DictVersion < 2)
+              )
+                {
+                fprintf(stderr,"-G option: specify -G1 (old format), -G2 (memory mappable format), -G2t (memory mappable format with double-array trie) and/or -G2f (memory mappable format with front coded strings)\n");
+                return OptReturnTp::Error;
+                }
+            }
+            break;
+#endif
         case 'h':
         case '?':
             LOG1LINE("usage:\n============================");
@@ -272,7 +314,7 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
 #else
             printf("%s -D \\\n",progname);
 #endif
-            LOG1LINE("         -c<format> [-N<frequency file> -n<format>] [-y[-]] \\\n"
+            LOG1LINE("         -c<format> [-N<frequency file> -n<format>] [-y[-]] [-G<n>] \\\n"
                    "        [-i<lemmafile>] [-o<binarydictionary>]\n"
                    "    -c  column format of dictionary (tab separated), e.g. -cBFT, which means:\n"
                    "        1st column B(ase form), 2nd column F(ull form), 3rd column T(ype)\n"
@@ -283,8 +325,29 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
                    "    -y  test output\n    -y- release output (default)\n"
                    "    -k  collapse homographs (remove \",n\" endings)(default)\n"
                    "    -k- do not collapse homographs (keep \",n\" endings)\n"
+                   "    -G1 old dictionary format (default)\n"
+                   "    -G2 memory mappable dictionary format\n"
+                   "    -G2t memory mappable dictionary format with double-array trie for\n"
+                   "        faster look-up\n"
+                   "    -G2f memory mappable dictionary format with front coded strings:\n"
+                   "        smaller, but slower look-up (unless combined with t: -G2tf)\n"
+                   "    -P<rate> add Bloom filter with false positive rate <rate> (e.g. 0.01)\n"
+                   "        (only -G2)\n"
+                   "===============================");
+#if defined PROGLEMMATISE
+            LOG1LINE("    Fold delta dictionary into binary dictionary");
+#if STREAM
+            cout << progname << " -D \\" << endl;
+#else
+            printf("%s -D \\\n",progname);
+#endif
+            LOG1LINE("         -d<binarydictionary> -O<delta dictionary> [-G<n>] [-P<rate>] \\\n"
+                   "        [-o<new binarydictionary>]\n"
+                   "    -O  delta dictionary (see -O under Lemmatise). The new dictionary has\n"
+                   "        the readings of both.\n"
                    "===============================");
 #endif
+#endif
 #if defined PROGMAKESUFFIXFLEX
             LOG1LINE("    Create or add flex patterns");
             LOG1LINE("    (Deprecated. Use the 'affixtrain' program instead. See https://github.com/kuhumcst/affixtrain)");
@@ -307,6 +370,19 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
                    "=============");
 #endif
 #if defined PROGLEMMATISE
+            LOG1LINE("    Create model bundle");
+#if STREAM
+            cout << progname << " -Z \\" << endl;
+#else
+            printf("%s -Z \\\n",progname);
+#endif
+            LOG1LINE("         -f<flex patterns> [-d<binary dictionary>] [-v<tag friends file>] \\\n"
+                   "        [-x<Lexical type translation table>] [-z<type conversion table>] \\\n"
+                   "        -o<bundle>\n"
+                   "    Puts the files and the tag specific flex patterns (<flex patterns>.<tag>)\n"
+                   "    in one file that can be used as -f<bundle> when lemmatising.\n"
+                   "    The dictionary must have the memory mappable format (-G2).\n"
+                   "===============================");
             LOG1LINE("    Lemmatise\n");
 #if STREAM
             cout << progname << " [-L] \\" << endl;
@@ -338,9 +414,26 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
                    "    -d<binarydictionary>\tDictionary as produced with the -D option set.\n"  
                    "        If no dictionary is specified, only the flex patterns are used.\n"  
                    "        Without dictionary, wrong tags in the input can not be corrected.\n"
+                   "    -a  load the dictionary in the background. Until it is loaded,\n"
+                   "        strings are lemmatised with the flex patterns only.\n"
+                   "        (Files are not lemmatised before the dictionary is loaded.)\n"
+                   "    -a- load the dictionary before lemmatising (default)\n"
+                   "    -O<delta dictionary>\tText file with readings that are added to the\n"
+                   "        dictionary (-d) without rebuilding it. One reading per line:\n"
+                   "        full form<tab>type<tab>base form[<tab>frequency]\n"
+                   "        The delta is consulted before the dictionary. Fold it into the\n"
+                   "        dictionary with -D -d<binarydictionary> -O<delta dictionary>\n"
+                   "    -K<warm cache>\tFile made with -M. Look-ups of the words in it skip\n"
+                   "        the dictionary and the flex patterns. The file is not used if it\n"
+                   "        was made with other -f, -d, -O, -v, -x, -z or -e arguments.\n"
+                   "    -M<warm cache>\tWrite the outcome of the look-ups of the most\n"
+                   "        frequent words (see -T) to a warm cache file for -K.\n"
+                   "    -T<n>\tNumber of words in the warm cache (default 50000)\n"
                    "    -f<flexpatterns>\tFile with flex patterns. (see -F). Best results for\n"
                    "        untagged input are obtained if the rules are made without lexical type\n"
-                   "        information. See -c option above.");  
+                   "        information. See -c option above.\n"
+                   "        A model bundle (see -Z) also provides the dictionary and the -v, -x\n"
+                   "        and -z files, unless they are given.");  
 #if STREAM
             cout << "    -b<format string>\tdefault:" commandlineQuote << Default_b_format << commandlineQuote << endl;  
 #else
@@ -492,6 +585,26 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
                    "        form, as defined by the table. Format:\n"
                    "             {<full form type> <space> <base form type> <newline>}*\n"
                    "    -m<size>: Max. number of words in input. Default: 0 (meaning: unlimited)\n"
+                   "    -J<n>: Sort the words and lemmas for -q, -b and -B in n threads\n"
+                   "        (default 1). The output is the same as with one.\n"
+                   "    -Q<n>: Between strings, a reused text keeps its arrays and its type\n"
+                   "        table, unless they have room for more than n words (default 65536).\n"
+                   "    -S<n>: Lemmatise the input in chunks of about n words, each ending at\n"
+                   "        a line end, so that memory use doesn't grow with the input.\n"
+                   "        Only for output in input order (no -q, -b or -B). Not with $f,\n"
+                   "        -H0 or -H1, which need the frequencies in the whole input.\n"
+                   "        The input is read twice, unless it is a pipe. Then whether a\n"
+                   "        capitalised word at the start of a line is looked up in lower\n"
+                   "        case is decided per chunk. The look-ups of the -T most frequent\n"
+                   "        words are kept from chunk to chunk.\n"
+                   "    -j<n>: Split the input at line ends in n parts and lemmatise them in\n"
+                   "        n processes. The output is the same as with one process. Only\n"
+                   "        for output in input order (no -q, -b or -B) and not with $f,\n"
+                   "        -H0, -H1, -I, -m, -S or -M. Otherwise, and if the input is not a\n"
+                   "        file, one process is used. Not on Windows.\n"
+                   "    -P<rate> if the dictionary has no Bloom filter, make one with false\n"
+                   "        positive rate <rate> (e.g. 0.01) when the dictionary is read.\n"
+                   "    -P- do not use the dictionary's Bloom filter.\n"
                    "    -A  Treat / as separator between alternative words.\n"
                    "    -A- Do not treat / as separator between alternative words (default)\n"
                    "    -e<n> ISO8859 Character encoding. 'n' is one of 1,2,7 and 9 (ISO8859-1,2, etc).\n"
@@ -538,6 +651,26 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
             delete [] Iformat;
             Iformat = dupl(locoptarg); 
             break;
+        case 'j':
+            jobs = locoptarg ? atoi(locoptarg) : 0;
+            if(jobs < 1)
+                {
+                LOG1LINE("-j option: specify the number of processes, e.g. -j4");
+                return OptReturnTp::Error;
+                }
+            break;
+        case 'J':
+            threads = locoptarg ? atoi(locoptarg) : 0;
+            if(threads < 1)
+                {
+                LOG1LINE("-J option: specify the number of threads, e.g. -J4");
+                return OptReturnTp::Error;
+                }
+            break;
+        case 'K':
+            delete [] warmcache;
+            warmcache = dupl(locoptarg);
+            break;
         case 'l':
             baseformsAreLowercase = (!locoptarg || !*locoptarg) ? caseTp::elower : *locoptarg == '-' ? caseTp::easis : caseTp::emimicked;
             break;
@@ -546,6 +679,10 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
             whattodo = whattodoTp::LEMMATISE; // default action
             break;
 #if defined PROGLEMMATISE
+        case 'M':
+            delete [] warmcacheout;
+            warmcacheout = dupl(locoptarg);
+            break;
         case 'm':
             if(locoptarg)
                 {
@@ -596,6 +733,10 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
             argo = dupl(locoptarg);
             break;
 #if defined PROGLEMMATISE
+        case 'O':
+            delete [] delta;
+            delta = dupl(locoptarg);
+            break;
         case 'p':
             if(locoptarg)
                 {
@@ -626,6 +767,26 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
                 keepPunctuation = 1;
                 }
             break;
+#endif
+#if (defined PROGLEMMATISE) || (defined PROGMAKEDICT)
+        case 'P':
+            if(locoptarg && *locoptarg == '-')
+                BloomRate = -1.0;
+            else
+                {
+                BloomRate = locoptarg ? strtod(locoptarg,NULL) : 0.0;
+                if(BloomRate <= 0.0 || BloomRate >= 1.0)
+                    {
+                    fprintf(stderr,"-P option: specify a false positive rate between 0 and 1, e.g. -P0.01\n");
+                    return OptReturnTp::Error;
+                    }
+                }
+            break;
+#endif
+#if defined PROGLEMMATISE
+        case 'Q':
+            keep = locoptarg ? strtoul(locoptarg,NULL,10) : 0;
+            break;
         case 'q':
             if(!locoptarg)
                 {
@@ -760,6 +921,22 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
         case 't':
             InputHasTags = locoptarg == NULL || *locoptarg != '-';
             break;
+        case 'S':
+            chunk = locoptarg ? strtoul(locoptarg,NULL,10) : 0;
+            if(chunk == 0)
+                {
+                LOG1LINE("-S option: specify the number of words in a chunk, e.g. -S1000000");
+                return OptReturnTp::Error;
+                }
+            break;
+        case 'T':
+            warmsize = locoptarg ? strtoul(locoptarg,NULL,10) : 0;
+            if(warmsize == 0)
+                {
+                LOG1LINE("-T option: specify the number of types in the warm cache, e.g. -T50000");
+                return OptReturnTp::Error;
+                }
+            break;
         case 'u':
             DictUnique = locoptarg == NULL  || *locoptarg != '-';
             break;
@@ -837,6 +1014,9 @@ OptReturnTp optionStruct::doSwitch(int c,char * locoptarg,char * progname)
         case 'z':
             z = dupl(locoptarg);
             break;
+        case 'Z':
+            whattodo = whattodoTp::MAKEBUNDLE;
+            break;
 #endif
         case 'y':
             nice = locoptarg == NULL  || *locoptarg != '-';
@@ -25,7 +25,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 class FreqFile;
 #endif
 
-enum class whattodoTp {MAKEDICT,MAKEFLEXPATTERNS,LEMMATISE};
+enum class whattodoTp {MAKEDICT,MAKEFLEXPATTERNS,LEMMATISE,MAKEBUNDLE};
 enum class OptReturnTp {GoOn = 0,Leave = 1,Error = 2};
 
 #if defined _WIN32
@@ -55,17 +55,28 @@ struct optionStruct
     static const char * Default_B_format; // -B
 #endif
     // program task
-    whattodoTp whattodo; // -D, -F, -L
+    whattodoTp whattodo; // -D, -F, -L, -Z
 
     // -D: Make dictionary
 #if defined PROGMAKEDICT
     bool CollapseHomographs; // -k makedict
     FreqFile * freq; // -n, -N makedict
+    int DictVersion; // -G makedict
+    bool DoubleArray; // -G2t makedict
+    bool FrontCoded; // -G2f makedict
+#endif
+#if (defined PROGLEMMATISE) || (defined PROGMAKEDICT)
+    double BloomRate; // -P makedict, lemmatise
 #endif
     // -L
     // linguistic resources
 #if defined PROGLEMMATISE
     const char * dictfile;  // -d
+    const char * delta;     // -O
+    bool AsyncDict;         // -a
+    const char * warmcache;    // -K
+    const char * warmcacheout; // -M
+    unsigned long warmsize;    // -T
 #endif
 #if (defined PROGLEMMATISE) || (defined PROGMAKESUFFIXFLEX)
     const char * flx;       // -f
@@ -85,6 +96,10 @@ struct optionStruct
     bool nice;                       // -y makedict, text::text, text::Lemmatise
 #if defined PROGLEMMATISE
     unsigned long int size;                 // -m text::text
+    unsigned long int chunk;                // -S Lemmatiser::LemmatiseText
+    int jobs;                               // -j Lemmatiser::LemmatiseText
+    int threads;                            // -J text::SortThreads
+    unsigned long int keep;                 // -Q text::clear
     bool treatSlashAsAlternativesSeparator; // -A text::text
     bool XML;                               // -X
 
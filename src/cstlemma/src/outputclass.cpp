@@ -40,7 +40,15 @@ using namespace std;
 int OutputClass::COUNT = 0;
 #endif
 
+/* Parse format into tree and compile the tree. */
 const char *OutputClass::Format(const char *format, getFunction gfnc, functionTree &tree, const char *allFormat, bool &SortInput, int &testType)
+{
+    const char *ret = parse(format, gfnc, tree, allFormat, SortInput, testType);
+    tree.compile();
+    return ret;
+}
+
+const char *OutputClass::parse(const char *format, getFunction gfnc, functionTree &tree, const char *allFormat, bool &SortInput, int &testType)
 {
     int loctestType = 0;
     int locloctestType = 0;
@@ -123,7 +131,7 @@ const char *OutputClass::Format(const char *format, getFunction gfnc, functionTr
     {
         tree.setComp(comparison::etest);
         const char *newf = f + 1;
-        newf = Format(newf, gfnc, tree.addChild(), allFormat, SortInput, locloctestType);
+        newf = parse(newf, gfnc, tree.addChild(), allFormat, SortInput, locloctestType);
         if (!newf || *newf != ']')
         {
             fprintf(stderr, "No matching ] in format \"%s\"\n", allFormat);
@@ -237,7 +245,7 @@ const char *OutputClass::Format(const char *format, getFunction gfnc, functionTr
     }
 
     testType |= loctestType;
-    return Format(f, gfnc, tree.addNext(), allFormat, SortInput, testType);
+    return parse(f, gfnc, tree.addNext(), allFormat, SortInput, testType);
 }
 
 #endif
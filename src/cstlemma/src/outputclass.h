@@ -38,6 +38,8 @@ typedef formattingFunction * (*getFunction)(int kar,bool & SortInput,int & testT
 class OutputClass
     {
 #if defined PROGLEMMATISE
+    private:
+        static const char * parse(const char * format,getFunction gfnc,functionTree & tree,const char * allFormat,bool & SortInput,int & testType);
     public:
         virtual ~OutputClass()
             {
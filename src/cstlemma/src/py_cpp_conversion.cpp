@@ -22,6 +22,22 @@ PyObject *vectorStringToList(const vector<string> &data) {
 	return listObj;
 }
 
+PyObject *vectorStringBoolToList(const vector<string> &data, const vector<bool> &flags) {
+    PyObject *listObj = PyList_New(data.size());
+	if (!listObj) throw logic_error("Unable to allocate memory for Python list 1");
+	
+	for (unsigned int i = 0; i < data.size(); i++) {
+		PyObject *pair = Py_BuildValue("(NO)", PyUnicode_FromString(data[i].c_str()), flags[i] ? Py_True : Py_False);
+		if (!pair) {
+			Py_DECREF(listObj);
+			throw logic_error("Unable to allocate memory for Python list 2");
+		}
+		PyList_SET_ITEM(listObj, i, pair);
+	}
+    
+	return listObj;
+}
+
 vector<string> listToVectorString(PyObject *incoming) {
 	vector<string> data;
     
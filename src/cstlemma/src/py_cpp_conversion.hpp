@@ -8,6 +8,8 @@
 
 PyObject *vectorStringToList(const std::vector<std::string> &data);
 
+PyObject *vectorStringBoolToList(const std::vector<std::string> &data, const std::vector<bool> &flags);
+
 std::vector<std::string> listToVectorString(PyObject *incoming);
 
 #endif
\ No newline at end of file
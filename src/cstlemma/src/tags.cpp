@@ -30,6 +30,87 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 const char NOT_KNOWN[] = "NOT_KNOWN";
 
+char ** tagregistry::names = NULL;
+tindex * tagregistry::dicttypes = NULL;
+int * tagregistry::slots = NULL;
+int tagregistry::ntags = 0;
+int tagregistry::nslots = 0;
+
+/* Slot in the hash table that has tag or, if tag is not registered, the
+   empty slot where it belongs. */
+int tagregistry::slot(const char * tag)
+    {
+    unsigned int h = 2166136261u; // FNV-1a
+    for(const char * t = tag;*t;++t)
+        h = (h ^ (unsigned char)*t) * 16777619u;
+    int mask = nslots - 1;
+    int s = (int)(h & mask);
+    while(slots[s] >= 0 && strcmp(names[slots[s]],tag))
+        s = (s + 1) & mask;
+    return s;
+    }
+
+int tagregistry::find(const char * tag)
+    {
+    return nslots ? slots[slot(tag)] : -1;
+    }
+
+int tagregistry::add(const char * tag)
+    {
+    if(2 * (ntags + 1) > nslots) // grow, keep load factor <= 0.5
+        {
+        int * oldslots = slots;
+        int oldnslots = nslots;
+        nslots = nslots ? 2 * nslots : 64;
+        slots = new int[nslots];
+        for(int s = 0;s < nslots;++s)
+            slots[s] = -1;
+        for(int s = 0;s < oldnslots;++s)
+            if(oldslots[s] >= 0)
+                slots[slot(names[oldslots[s]])] = oldslots[s];
+        delete [] oldslots;
+        char ** oldnames = names;
+        tindex * olddicttypes = dicttypes;
+        names = new char * [nslots / 2];
+        dicttypes = new tindex[nslots / 2];
+        for(int i = 0;i < ntags;++i)
+            {
+            names[i] = oldnames[i];
+            dicttypes[i] = olddicttypes[i];
+            }
+        delete [] oldnames;
+        delete [] olddicttypes;
+        }
+    int s = slot(tag);
+    if(slots[s] < 0)
+        {
+        names[ntags] = new char[strlen(tag) + 1];
+        strcpy(names[ntags],tag);
+        dicttypes[ntags] = -1;
+        slots[s] = ntags++;
+        }
+    return slots[s];
+    }
+
+void tagregistry::clearDictTypes()
+    {
+    for(int i = 0;i < ntags;++i)
+        dicttypes[i] = -1;
+    }
+
+void tagregistry::clear()
+    {
+    for(int i = 0;i < ntags;++i)
+        delete [] names[i];
+    delete [] names;
+    delete [] dicttypes;
+    delete [] slots;
+    names = NULL;
+    dicttypes = NULL;
+    slots = NULL;
+    ntags = nslots = 0;
+    }
+
 /*
 e.g.
 PRON PRON_DEMO PRON_UBST PRON_PERS PRON_POSS PRON_INTER_REL
@@ -39,7 +120,7 @@ tags (but also "PRON" and "V") can occur in the text. Before dictionary
 look-up, e.g. "V_PAST" is converted to "V".
 */
 
-tagpairs::tagpairs(FILE * fpx,bool nice):textTags(NULL),dictTags(NULL),tagcnt(0),X(NULL)
+tagpairs::tagpairs(FILE * fpx,bool nice):textTags(NULL),dictTags(NULL),tagcnt(0),X(NULL),textIds(NULL),dictIds(NULL),translation(NULL),group(NULL),ntable(0)
     {
 #ifdef COUNTOBJECTS
     ++COUNT;
@@ -103,6 +184,29 @@ tagpairs::tagpairs(FILE * fpx,bool nice):textTags(NULL),dictTags(NULL),tagcnt(0)
                 printf("%s %s\n",dictTags[i],textTags[i]);
             }
         }
+    makeTables();
+    }
+
+void tagpairs::makeTables()
+    {
+    textIds = new int[tagcnt];
+    dictIds = new int[tagcnt];
+    int i;
+    for(i = 0;i < tagcnt;++i)
+        {
+        textIds[i] = tagregistry::add(textTags[i]);
+        dictIds[i] = tagregistry::add(dictTags[i]);
+        }
+    ntable = tagregistry::count();
+    translation = new int[ntable];
+    group = new int[ntable];
+    for(i = 0;i < ntable;++i)
+        translation[i] = group[i] = -1;
+    for(i = tagcnt;--i >= 0;) // backwards: the first occurrence wins
+        {
+        translation[textIds[i]] = i;
+        group[dictIds[i]] = i;
+        }
     }
 
 
@@ -111,6 +215,10 @@ tagpairs::~tagpairs()
     delete [] dictTags;
     delete [] textTags;
     delete [] X;
+    delete [] textIds;
+    delete [] dictIds;
+    delete [] translation;
+    delete [] group;
 #ifdef COUNTOBJECTS
     --COUNT;
 #endif
@@ -118,39 +226,29 @@ tagpairs::~tagpairs()
 
 const char * tagpairs::translate(const char * Tp)
     {
-    static int i = 0;
-    if(tagcnt && !strcmp(Tp,textTags[i]))
-        return dictTags[i]; // optimisation. (Often the same tag must be translated many times in sequence).
-    for(i = 0;i < tagcnt;++i)
-        {
-        if(!strcmp(Tp,textTags[i]))
-            {
-            return dictTags[i]; // translate tag to dictionary-type
-            }
-        }
-    i = 0;
+    int id = tagregistry::find(Tp);
+    if(0 <= id && id < ntable && translation[id] >= 0)
+        return dictTags[translation[id]]; // translate tag to dictionary-type
     return Tp;
     }
 
 int tagpairs::Closeness(const char * tag,const char * t)
     {
-    for(int i = 0;i < tagcnt;++i)
+    int id = tagregistry::find(tag);
+    if(id < 0 || id >= ntable || group[id] < 0)
+        return -1;
+    int tid = tagregistry::find(t);
+    int i = group[id];
+    int dist = 0;
+    do 
         {
-        if(!strcmp(tag,dictTags[i]))
+        if(textIds[i] == tid)
             {
-            int dist = 0;
-            do 
-                {
-                if(!strcmp(textTags[i],t))
-                    {
-                    return dist;
-                    }
-                ++dist;
-                }
-            while(++i < tagcnt && !strcmp(tag,dictTags[i]));
-            return -1;
+            return dist;
             }
+        ++dist;
         }
+    while(++i < tagcnt && dictIds[i] == id);
     return -1;
     }
 #endif
@@ -24,8 +24,39 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "defines.h"
 #if defined PROGLEMMATISE
+#include "lem.h"
 #include <stdio.h>
 
+/*
+All tags that the lemmatiser reads from its tag files (-x, -v, -z) and
+from the dictionary get a small integer ID, so that tags can be translated
+and compared by table look-up. Tags are registered while these files are
+loaded. During lemmatisation, the registry is only read.
+*/
+class tagregistry
+    {
+    private:
+        static char ** names;
+        static tindex * dicttypes; // index of tag in dictionary's strings, or -1
+        static int * slots;        // open addressing hash table of IDs, -1 if empty
+        static int ntags;
+        static int nslots;
+        static int slot(const char * tag);
+    public:
+        static int find(const char * tag); // -1 if tag is not registered
+        static int add(const char * tag);
+        static int count(){return ntags;}
+        static const char * name(int id){return names[id];}
+        static void setDictType(int id,tindex type){dicttypes[id] = type;}
+        static tindex dictType(const char * tag) // -1 if not in dictionary
+            {
+            int id = find(tag);
+            return id < 0 ? -1 : dicttypes[id];
+            }
+        static void clearDictTypes();
+        static void clear();
+    };
+
 class tagpairs
     {
 #ifdef COUNTOBJECTS
@@ -38,6 +69,12 @@ class tagpairs
         // tags that occur in the text as well as in the dictionary are not listed.
         int tagcnt;
         char * X;
+        int * textIds;      // tag IDs of textTags
+        int * dictIds;      // tag IDs of dictTags
+        int * translation;  // tag ID -> first i with textIds[i] == tag ID, or -1
+        int * group;        // tag ID -> first i with dictIds[i] == tag ID, or -1
+        int ntable;         // size of translation and group
+        void makeTables();
     public:
         tagpairs(FILE * fpx,bool nice);
         ~tagpairs();
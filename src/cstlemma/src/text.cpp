@@ -28,15 +28,134 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "basefrm.h"
 #include "flex.h"
 #include "lext.h"
+#include "utf8func.h"
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
-#include "hashmap.h"
+#include "dictionary.h"
 
 #include <string>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 
-static hashmap::hash<Word> *Hash = 0;
+#define LOOKUPBATCHMIN 64 // Fewer words are looked up in text order.
+
+#define TYPETABLEMIN 1024 // Initial number of slots in the type table.
+
+/* The types of a text: open addressing with linear probing, keyed on the
+   word and, for tagged input, the tag. Each slot keeps the key's hash next to
+   the type, so that a probe only visits words whose hash matches. The table
+   doubles when it gets half full, without hashing the keys again. list()
+   gives the types in the order in which they were first inserted. A text
+   that is reused empties its table with clear(), which keeps the slots. */
+class typeTable
+{
+    struct slot
+    {
+        size_t hash;
+        Word *word;
+    };
+    slot *slots;
+    size_t mask;
+    size_t n;
+    Word **types;
+
+    void grow()
+    {
+        size_t size = 2 * (mask + 1);
+        slot *old = slots;
+        slots = new slot[size];
+        memset(slots, 0, size * sizeof(slot));
+        for (size_t i = 0; i <= mask; ++i)
+        {
+            if (old[i].word)
+            {
+                size_t j = old[i].hash & (size - 1);
+                while (slots[j].word)
+                    j = (j + 1) & (size - 1);
+                slots[j] = old[i];
+            }
+        }
+        delete[] old;
+        Word **oldtypes = types;
+        types = new Word *[size / 2];
+        memcpy(types, oldtypes, n * sizeof(Word *));
+        delete[] oldtypes;
+        mask = size - 1;
+    }
+
+public:
+    typeTable() : slots(new slot[TYPETABLEMIN]), mask(TYPETABLEMIN - 1), n(0), types(new Word *[TYPETABLEMIN / 2])
+    {
+        memset(slots, 0, TYPETABLEMIN * sizeof(slot));
+    }
+    ~typeTable()
+    {
+        delete[] slots;
+        delete[] types;
+    }
+    static size_t hash(const char *w, const char *tag)
+    {
+        size_t h = (size_t)14695981039346656037ULL; // FNV-1a
+        for (; *w; ++w)
+            h = (h ^ (unsigned char)*w) * (size_t)1099511628211ULL;
+        if (tag)
+        {
+            h = (h ^ 0xFF) * (size_t)1099511628211ULL; // between word and tag
+            for (; *tag; ++tag)
+                h = (h ^ (unsigned char)*tag) * (size_t)1099511628211ULL;
+        }
+        return h;
+    }
+    /* Returns the type of w (and tag, if not null), or null with i set to
+       the slot where it is to be added. */
+    Word *find(const char *w, const char *tag, size_t h, size_t &i) const
+    {
+        for (i = h & mask; slots[i].word; i = (i + 1) & mask)
+        {
+            if (slots[i].hash == h && !strcmp(slots[i].word->m_word, w) && (!tag || !strcmp(slots[i].word->m_tag, tag)))
+                return slots[i].word;
+        }
+        return 0;
+    }
+    void add(Word *word, size_t h, size_t i)
+    {
+        slots[i].hash = h;
+        slots[i].word = word;
+        types[n++] = word;
+        if (2 * n > mask)
+            grow();
+    }
+    Word **list(size_t &N) const
+    {
+        N = n;
+        return types;
+    }
+    /* The room for types, without growing. */
+    size_t capacity() const
+    {
+        return (mask + 1) / 2;
+    }
+    /* Only the slots of the types are visited, so that a table that once
+       grew big is emptied as fast as a small one. Call before the types are
+       deleted. */
+    void clear()
+    {
+        for (size_t k = 0; k < n; ++k)
+        {
+            size_t i = hash(types[k]->m_word, types[k]->m_tag) & mask;
+            while (slots[i].word != types[k])
+                i = (i + 1) & mask;
+            slots[i].word = 0;
+        }
+        n = 0;
+    }
+};
+
+int text::SortThreads = 1;
 
 #ifdef COUNTOBJECTS
 int text::COUNT = 0;
@@ -165,6 +284,284 @@ static int cmpBaseforms_fw(const basefrm *n1, const basefrm *n2)
 static int (*pcmpBaseforms)(const basefrm *elem1, const basefrm *elem2) = cmpBaseforms_w;
 static int (*pcmpBaseforms_f)(const basefrm *elem1, const basefrm *elem2) = cmpBaseforms_fw;
 
+/* The sorted output modes sort the words and the lemmas by MSD radix sort
+   instead of by qsort with the comparators above. The key of a word or lemma
+   is gathered once: up to three parts, in the order of the comparator, each
+   either a string, which ends at its terminating zero, or a frequency, which
+   is sorted as four bytes, highest byte first. Short ranges are finished by
+   insertion sort. Ranges still unsorted after SORTLEVELMAX levels, keys
+   that share a long prefix, are finished by stable_sort, so that the stack
+   stays small. The sort is stable, as glibc's qsort is, so that lemmas that
+   compare equal are merged in the same order as before. With -J, the buckets
+   of a large sort are sorted in SortThreads threads. */
+#define SORTRADIXMIN 32     // Fewer keys are sorted by insertion.
+#define SORTLEVELMAX 64     // Deeper ranges are sorted by comparison.
+#define SORTTHREADMIN 65536 // Fewer keys are sorted in one thread.
+
+enum sortPart
+{
+    SP_END,
+    SP_WORD,
+    SP_TAG,
+    SP_FREQ
+};
+
+struct sortKey
+{
+    const unsigned char *word;
+    const unsigned char *tag;
+    unsigned int freq; // descending frequency, as an ascending key
+    void *item;
+};
+
+static unsigned int descending(int freq)
+{
+    return ~((unsigned int)freq ^ 0x80000000u);
+}
+
+static bool hasPart(const char *plan, int part)
+{
+    for (; *plan != SP_END; ++plan)
+        if (*plan == part)
+            return true;
+    return false;
+}
+
+static unsigned int keyByte(const sortKey &key, int part, size_t depth)
+{
+    switch (part)
+    {
+    case SP_WORD:
+        return key.word[depth];
+    case SP_TAG:
+        return key.tag[depth];
+    default:
+        return (key.freq >> (24 - 8 * depth)) & 0xFF;
+    }
+}
+
+/* The part and depth of the byte after byte b of the current part. */
+static void nextByte(const char *&plan, size_t &depth, unsigned int b)
+{
+    if (*plan == SP_FREQ ? depth == 3 : b == 0)
+    {
+        ++plan;
+        depth = 0;
+    }
+    else
+        ++depth;
+}
+
+static int compareKeys(const sortKey &a, const sortKey &b, const char *plan, size_t depth)
+{
+    for (; *plan != SP_END; ++plan, depth = 0)
+    {
+        int c;
+        switch (*plan)
+        {
+        case SP_WORD:
+            c = strcmp((const char *)a.word + depth, (const char *)b.word + depth);
+            break;
+        case SP_TAG:
+            c = strcmp((const char *)a.tag + depth, (const char *)b.tag + depth);
+            break;
+        default:
+            c = a.freq < b.freq ? -1 : a.freq > b.freq;
+        }
+        if (c)
+            return c;
+    }
+    return 0;
+}
+
+static void insertionSort(sortKey *keys, size_t n, const char *plan, size_t depth)
+{
+    for (size_t i = 1; i < n; ++i)
+    {
+        sortKey key = keys[i];
+        size_t j = i;
+        for (; j > 0 && compareKeys(keys[j - 1], key, plan, depth) > 0; --j)
+            keys[j] = keys[j - 1];
+        keys[j] = key;
+    }
+}
+
+struct sortKeyLess
+{
+    const char *plan;
+    size_t depth;
+    bool operator()(const sortKey &a, const sortKey &b) const
+    {
+        return compareKeys(a, b, plan, depth) < 0;
+    }
+};
+
+static void radixSort(sortKey *keys, sortKey *tmp, size_t n, const char *plan, size_t depth, int level, int threads);
+
+struct sortBuckets
+{
+    sortKey *keys;
+    sortKey *tmp;
+    const size_t *start;
+    const char *plan;
+    size_t depth;
+    int level;
+    std::atomic<int> next;
+};
+
+static void sortSomeBuckets(sortBuckets *buckets)
+{
+    int b;
+    while ((b = buckets->next++) < 256)
+    {
+        size_t from = buckets->start[b];
+        size_t n = buckets->start[b + 1] - from;
+        if (n > 1)
+        {
+            const char *plan = buckets->plan;
+            size_t depth = buckets->depth;
+            nextByte(plan, depth, b);
+            radixSort(buckets->keys + from, buckets->tmp + from, n, plan, depth, buckets->level + 1, 1);
+        }
+    }
+}
+
+static void radixSort(sortKey *keys, sortKey *tmp, size_t n, const char *plan, size_t depth, int level, int threads)
+{
+    while (*plan != SP_END)
+    {
+        if (n < SORTRADIXMIN)
+        {
+            insertionSort(keys, n, plan, depth);
+            return;
+        }
+        if (level > SORTLEVELMAX)
+        {
+            sortKeyLess less = {plan, depth};
+            std::stable_sort(keys, keys + n, less);
+            return;
+        }
+        size_t start[257]; // bucket b is keys[start[b]] ... keys[start[b + 1] - 1]
+        memset(start, 0, sizeof(start));
+        for (size_t i = 0; i < n; ++i)
+            ++start[keyByte(keys[i], *plan, depth)];
+        unsigned int first = keyByte(keys[0], *plan, depth);
+        if (start[first] == n) // All keys have the same byte here.
+        {
+            nextByte(plan, depth, first);
+            continue;
+        }
+        for (int b = 1; b < 256; ++b)
+            start[b] += start[b - 1];
+        start[256] = n;
+        // Going backwards keeps the sort stable and leaves each start[b] at
+        // the beginning of its bucket.
+        for (size_t i = n; i-- > 0;)
+            tmp[--start[keyByte(keys[i], *plan, depth)]] = keys[i];
+        memcpy(keys, tmp, n * sizeof(sortKey));
+
+        sortBuckets buckets;
+        buckets.keys = keys;
+        buckets.tmp = tmp;
+        buckets.start = start;
+        buckets.plan = plan;
+        buckets.depth = depth;
+        buckets.level = level;
+        buckets.next = 0;
+        if (threads > 1 && n >= SORTTHREADMIN)
+        {
+            std::thread **helpers = new std::thread *[threads - 1];
+            for (int t = 0; t < threads - 1; ++t)
+                helpers[t] = new std::thread(sortSomeBuckets, &buckets);
+            sortSomeBuckets(&buckets);
+            for (int t = 0; t < threads - 1; ++t)
+            {
+                helpers[t]->join();
+                delete helpers[t];
+            }
+            delete[] helpers;
+        }
+        else
+            sortSomeBuckets(&buckets);
+        return;
+    }
+}
+
+static void sortKeys(sortKey *keys, size_t n, const char *plan)
+{
+    sortKey *tmp = new sortKey[n];
+    radixSort(keys, tmp, n, plan, 0, 0, text::SortThreads);
+    delete[] tmp;
+}
+
+static const char plan_w[] = {SP_WORD, SP_END};
+static const char plan_wf[] = {SP_WORD, SP_FREQ, SP_END};
+static const char plan_fw[] = {SP_FREQ, SP_WORD, SP_END};
+static const char plan_wt[] = {SP_WORD, SP_TAG, SP_END};
+static const char plan_tw[] = {SP_TAG, SP_WORD, SP_END};
+static const char plan_ftw[] = {SP_FREQ, SP_TAG, SP_WORD, SP_END};
+static const char plan_fwt[] = {SP_FREQ, SP_WORD, SP_TAG, SP_END};
+static const char plan_wft[] = {SP_WORD, SP_FREQ, SP_TAG, SP_END};
+static const char plan_wtf[] = {SP_WORD, SP_TAG, SP_FREQ, SP_END};
+static const char plan_tfw[] = {SP_TAG, SP_FREQ, SP_WORD, SP_END};
+static const char plan_twf[] = {SP_TAG, SP_WORD, SP_FREQ, SP_END};
+
+/* The key parts of the current comparator, or 0 if it has no plan. */
+static const char *basefrmPlan(int (*cmp)(const basefrm *, const basefrm *))
+{
+    if (cmp == cmpBaseforms_w)
+        return plan_w;
+    if (cmp == cmpBaseforms_wt)
+        return plan_wt;
+    if (cmp == cmpBaseforms_wf)
+        return plan_wf;
+    if (cmp == cmpBaseforms_fw)
+        return plan_fw;
+    if (cmp == cmpBaseforms_twf)
+        return plan_tw; // cmpBaseforms_twf compares tags and words only
+    if (cmp == cmpBaseforms_ftw)
+        return plan_ftw;
+    if (cmp == cmpBaseforms_fwt)
+        return plan_fwt;
+    if (cmp == cmpBaseforms_tfw)
+        return plan_tfw;
+    if (cmp == cmpBaseforms_wft)
+        return plan_wft;
+    if (cmp == cmpBaseforms_wtf)
+        return plan_wtf;
+    return 0;
+}
+
+/* Sort the non-null lemmas to the front, in the order of cmp. Returns false
+   if cmp has no plan. */
+static bool radixSortBaseforms(basefrm **pbf, int cnt, int (*cmp)(const basefrm *, const basefrm *))
+{
+    const char *plan = basefrmPlan(cmp);
+    if (!plan)
+        return false;
+    bool freq = hasPart(plan, SP_FREQ);
+    sortKey *keys = new sortKey[cnt];
+    int n = 0;
+    for (int i = 0; i < cnt; ++i)
+    {
+        if (pbf[i])
+        {
+            keys[n].word = (const unsigned char *)pbf[i]->itsLemma();
+            keys[n].tag = (const unsigned char *)pbf[i]->itsTag();
+            keys[n].freq = freq ? descending(pbf[i]->lemmaFreq()) : 0;
+            keys[n].item = pbf[i];
+            ++n;
+        }
+    }
+    sortKeys(keys, n, plan);
+    for (int i = 0; i < n; ++i)
+        pbf[i] = (basefrm *)keys[i].item;
+    for (int i = n; i < cnt; ++i)
+        pbf[i] = 0;
+    delete[] keys;
+    return true;
+}
+
 static int compareBaseforms(const void *arg1, const void *arg2)
 {
     const basefrm *n1 = *(const basefrm *const *)arg1;
@@ -188,7 +585,8 @@ static int compareBaseforms_f(const void *arg1, const void *arg2)
 
 static int sortBaseforms(basefrm **pbf, int cnt)
 {
-    qsort((void *)pbf, cnt, sizeof(basefrm *), compareBaseforms);
+    if (!radixSortBaseforms(pbf, cnt, pcmpBaseforms))
+        qsort((void *)pbf, cnt, sizeof(basefrm *), compareBaseforms);
     int i = 0;
     int j = 1;
     int k = 0;
@@ -222,7 +620,8 @@ static int sortBaseforms(basefrm **pbf, int cnt)
 
 static void sortBaseforms_f(basefrm **pbf, int cnt)
 {
-    qsort((void *)pbf, cnt, sizeof(basefrm *), compareBaseforms_f);
+    if (!radixSortBaseforms(pbf, cnt, pcmpBaseforms_f))
+        qsort((void *)pbf, cnt, sizeof(basefrm *), compareBaseforms_f);
 }
 
 void text::AddField(field *fld)
@@ -349,8 +748,125 @@ static int cmpTagged(const void *arg1, const void *arg2)
     return (n1->*taggedWord::comp)(n2);
 }
 
+static const char *wordPlan(bool tagged)
+{
+    if (tagged)
+    {
+        if (taggedWord::comp == &taggedWord::cmptaggedword)
+            return plan_tw;
+        if (taggedWord::comp == &taggedWord::cmp_ftw)
+            return plan_ftw;
+        if (taggedWord::comp == &taggedWord::cmp_fwt)
+            return plan_fwt;
+        if (taggedWord::comp == &taggedWord::cmp_wft)
+            return plan_wft;
+        if (taggedWord::comp == &taggedWord::cmp_wtf)
+            return plan_wtf;
+        if (taggedWord::comp == &taggedWord::cmp_tfw)
+            return plan_tfw;
+        if (taggedWord::comp == &taggedWord::cmp_twf)
+            return plan_twf;
+    }
+    else
+    {
+        if (Word::cmp == &Word::cmpword)
+            return plan_w;
+        if (Word::cmp == &Word::comp_wf)
+            return plan_wf;
+        if (Word::cmp == &Word::comp_fw)
+            return plan_fw;
+    }
+    return 0;
+}
+
+static void sortWords(Word **words, size_t N, bool tagged)
+{
+    const char *plan = wordPlan(tagged);
+    if (!plan)
+    {
+        if (tagged)
+            qsort(words, N, sizeof(Word *), cmpTagged);
+        else
+            qsort(words, N, sizeof(Word *), cmpUntagged);
+        return;
+    }
+    sortKey *keys = new sortKey[N];
+    for (size_t i = 0; i < N; ++i)
+    {
+        keys[i].word = (const unsigned char *)words[i]->m_word;
+        keys[i].tag = (const unsigned char *)(tagged ? words[i]->m_tag : "");
+        keys[i].freq = descending(words[i]->itsCnt());
+        keys[i].item = words[i];
+    }
+    sortKeys(keys, N, plan);
+    for (size_t i = 0; i < N; ++i)
+        words[i] = (Word *)keys[i].item;
+    delete[] keys;
+}
+
+/* The first bytes of the word are in prefix, so that most comparisons
+   don't have to visit the words. */
+struct wordKey
+{
+    unsigned long long prefix;
+    Word *word;
+};
+
+static bool wordKeyLess(const wordKey &a, const wordKey &b)
+{
+    if (a.prefix != b.prefix)
+        return a.prefix < b.prefix;
+    return strcmp(a.word->itsWord(), b.word->itsWord()) < 0;
+}
+
+/* Look up the words in alphabetical order. The dictionary walks for the
+   sorted words are done in advance by dictionary::beginBatch, which skips
+   the prefix that a word shares with the previous word and interleaves
+   several walks. */
+void text::lookupWords()
+{
+    if (!Root)
+        return;
+    if (N < LOOKUPBATCHMIN)
+    {
+        for (size_t i = 0; i < N; ++i)
+        {
+            Root[i]->lookup(this);
+        }
+        return;
+    }
+    wordKey *sorted = new wordKey[N];
+    for (size_t i = 0; i < N; ++i)
+    {
+        const unsigned char *w = (const unsigned char *)Root[i]->itsWord();
+        unsigned long long prefix = 0;
+        for (size_t k = 0; k < sizeof(prefix); ++k)
+        {
+            prefix <<= 8;
+            if (*w)
+                prefix |= *w++;
+        }
+        sorted[i].prefix = prefix;
+        sorted[i].word = Root[i];
+    }
+    std::sort(sorted, sorted + N, wordKeyLess);
+    const char **words = new const char *[N];
+    for (size_t i = 0; i < N; ++i)
+        words[i] = sorted[i].word->itsWord();
+    dictionary::beginBatch(words, N);
+    for (size_t i = 0; i < N; ++i)
+    {
+        dictionary::batchWord(i);
+        sorted[i].word->lookup(this);
+    }
+    dictionary::endBatch();
+    delete[] words;
+    delete[] sorted;
+}
+
 void text::Lemmatise(FILE *fpo, const char *Sep, tallyStruct *tally, unsigned int SortOutput, int UseLemmaFreqForDisambiguation, bool nice, bool DictUnique, bool RulesUnique, caseTp baseformsAreLowercase, int listLemmas, bool mergeLemmas)
 {
+    arena::current = &Arena;
     flex::baseformsAreLowercase = baseformsAreLowercase;
     lext::baseformsAreLowercase = baseformsAreLowercase;
     Word::DictUnique = DictUnique;
@@ -452,13 +968,7 @@ void text::Lemmatise(FILE *fpo, const char *Sep, tallyStruct *tally, unsigned in
     cntL = 0;
     if (nice)
         LOG1LINE("looking up words");
-    if (Root)
-    {
-        for (size_t i = 0; i < N; ++i)
-        {
-            Root[i]->lookup(this);
-        }
-    }
+    lookupWords();
     if (tally)
     {
         tally->newhom = this->aConflict;
@@ -468,8 +978,7 @@ void text::Lemmatise(FILE *fpo, const char *Sep, tallyStruct *tally, unsigned in
     }
     if (mergeLemmas)
     {
-        basefrmarrD = new basefrm *[0];
-        basefrmarrL = new basefrm *[cntL + cntD];
+        allocBaseforms(0, cntL + cntD);
         ppD = &basefrmarrL[cntL];
         ppL = &basefrmarrL[0];
         cntL = cntL + cntD;
@@ -477,8 +986,7 @@ void text::Lemmatise(FILE *fpo, const char *Sep, tallyStruct *tally, unsigned in
     }
     else
     {
-        basefrmarrD = new basefrm *[cntD];
-        basefrmarrL = new basefrm *[cntL];
+        allocBaseforms(cntD, cntL);
         ppD = &basefrmarrD[0];
         ppL = &basefrmarrL[0];
     }
@@ -597,10 +1105,7 @@ void text::Lemmatise(FILE *fpo, const char *Sep, tallyStruct *tally, unsigned in
                 LOG1LINE("sorting words");
             if (Root)
             {
-                if (InputHasTags)
-                    qsort(Root, N, sizeof(Word *), cmpTagged);
-                else
-                    qsort(Root, N, sizeof(Word *), cmpUntagged);
+                sortWords(Root, N, InputHasTags);
                 for (size_t i = 0; i < N; ++i)
                     Root[i]->print();
             }
@@ -617,18 +1122,13 @@ void text::Lemmatise(FILE *fpo, const char *Sep, tallyStruct *tally, unsigned in
 
     if (nice)
         LOG1LINE("...text processed");
-    delete[] basefrmarrD;
-    delete[] basefrmarrL;
-
-    if (Root)
-    {
-        for (size_t i = 0; i < N; ++i)
-            Root[i]->deleteSecondaryStuff();
-    }
+    // The words are released with the text, so that -j can still write
+    // their types.
 }
 
 string text::Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOutput, int UseLemmaFreqForDisambiguation, bool nice, bool DictUnique, bool RulesUnique, caseTp baseformsAreLowercase, int listLemmas, bool mergeLemmas)
 {
+    arena::current = &Arena;
     flex::baseformsAreLowercase = baseformsAreLowercase;
     lext::baseformsAreLowercase = baseformsAreLowercase;
     Word::DictUnique = DictUnique;
@@ -691,13 +1191,7 @@ string text::Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOut
     cntL = 0;
     if (nice)
         LOG1LINE("looking up words");
-    if (Root)
-    {
-        for (size_t i = 0; i < N; ++i)
-        {
-            Root[i]->lookup(this);
-        }
-    }
+    lookupWords();
     if (tally)
     {
         tally->newhom = this->aConflict;
@@ -707,8 +1201,7 @@ string text::Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOut
     }
     if (mergeLemmas)
     {
-        basefrmarrD = new basefrm *[0];
-        basefrmarrL = new basefrm *[cntL + cntD];
+        allocBaseforms(0, cntL + cntD);
         ppD = &basefrmarrL[cntL];
         ppL = &basefrmarrL[0];
         cntL = cntL + cntD;
@@ -716,8 +1209,7 @@ string text::Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOut
     }
     else
     {
-        basefrmarrD = new basefrm *[cntD];
-        basefrmarrL = new basefrm *[cntL];
+        allocBaseforms(cntD, cntL);
         ppD = &basefrmarrD[0];
         ppL = &basefrmarrL[0];
     }
@@ -774,10 +1266,7 @@ string text::Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOut
             LOG1LINE("sorting words");
         if (Root)
         {
-            if (InputHasTags)
-                qsort(Root, N, sizeof(Word *), cmpTagged);
-            else
-                qsort(Root, N, sizeof(Word *), cmpUntagged);
+            sortWords(Root, N, InputHasTags);
             for (size_t i = 0; i < N; ++i)
                 Root[i]->print();
         }
@@ -786,6 +1275,7 @@ string text::Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOut
     {
         if (nice)
             LOG1LINE("print Unsorted words");
+        str.reserve(16 * total); // about a word, a lemma and separators per token
         writeUnsorted(str);
     }
     if (nice)
@@ -793,14 +1283,7 @@ string text::Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOut
 
     if (nice)
         LOG1LINE("...text processed");
-    delete[] basefrmarrD;
-    delete[] basefrmarrL;
-
-    if (Root)
-    {
-        for (size_t i = 0; i < N; ++i)
-            Root[i]->deleteSecondaryStuff();
-    }
+    releaseWords();
 
     return str;
 }
@@ -809,12 +1292,13 @@ void text::insert(const char *w)
 {
     static char wbuf[1000];
     w = convert(w, wbuf, wbuf + sizeof(wbuf) - 1);
-    if (!Hash)
+    if (!Types)
     {
-        Hash = new hashmap::hash<Word>(&Word::itsWord, 1000);
+        Types = new typeTable();
     }
-    void *v;
-    Word *wrd = Hash->find(w, v);
+    size_t h = typeTable::hash(w, 0);
+    size_t i;
+    Word *wrd = Types->find(w, 0, h, i);
     if (wrd)
     {
         wrd->inc();
@@ -822,7 +1306,7 @@ void text::insert(const char *w)
     else
     {
         wrd = new Word(w);
-        Hash->insert(wrd, v);
+        Types->add(wrd, h, i);
         if (StartOfLine)
             wrd->setSegmentInitial();
     }
@@ -834,6 +1318,8 @@ void text::insert(const char *w)
                                     is the right thing, unless the same word
                                     is found with uppercasing in a non-sentence
                                     initial position.*/
+    if (total >= tunsortedSize || lineno >= LinesSize)
+        reserve(total + 1, lineno + 1);
     tunsorted[total] = wrd;
     Lines[lineno] = total;
     ++total;
@@ -845,15 +1331,13 @@ void text::insert(const char *w, const char *tag)
     static char tbuf[1000];
     w = convert(w, wbuf, wbuf + sizeof(wbuf) - 1);
     tag = convert(tag, tbuf, wbuf + sizeof(tbuf) - 1);
-    if (!Hash)
+    if (!Types)
     {
-        Hash = (hashmap::hash<Word> *)new hashmap::hash<taggedWord>(&Word::itsWord, 1000);
+        Types = new typeTable();
     }
-    void *v;
-    taggedWord *wrd;
-    for (wrd = (taggedWord *)Hash->find(w, v); wrd && strcmp(wrd->m_tag, tag); wrd = (taggedWord *)Hash->findNext(w, v))
-        ;
-
+    size_t h = typeTable::hash(w, tag);
+    size_t i;
+    taggedWord *wrd = (taggedWord *)Types->find(w, tag, h, i);
     if (wrd)
     {
         wrd->inc();
@@ -861,7 +1345,7 @@ void text::insert(const char *w, const char *tag)
     else
     {
         wrd = new taggedWord(w, tag);
-        Hash->insert((Word *)wrd, v);
+        Types->add((Word *)wrd, h, i);
         if (StartOfLine)
             wrd->setSegmentInitial();
     }
@@ -873,11 +1357,63 @@ void text::insert(const char *w, const char *tag)
                                     is the right thing, unless the same word
                                     is found with uppercasing in a non-sentence
                                     initial position.*/
+    if (total >= tunsortedSize || lineno >= LinesSize)
+        reserve(total + 1, lineno + 1);
     tunsorted[total] = wrd;
     Lines[lineno] = total;
     ++total;
 }
 
+/* Make room for the base forms of the text. The arrays are kept for the next
+   call and for a reused text (see clear). */
+void text::allocBaseforms(int D, int L)
+{
+    if ((unsigned long int)D > basefrmarrDSize || !basefrmarrD)
+    {
+        delete[] basefrmarrD;
+        basefrmarrD = new basefrm *[D];
+        basefrmarrDSize = D;
+    }
+    if ((unsigned long int)L > basefrmarrLSize || !basefrmarrL)
+    {
+        delete[] basefrmarrL;
+        basefrmarrL = new basefrm *[L];
+        basefrmarrLSize = L;
+    }
+}
+
+/* Make room for at least words elements in tunsorted and lines elements in
+   Lines. The arrays grow geometrically, so a text can be read in one pass
+   without counting its words first. New elements of Lines are zero. */
+void text::reserve(unsigned long int words, unsigned long int lines)
+{
+    if (words > tunsortedSize)
+    {
+        unsigned long int size = 2 * tunsortedSize;
+        if (size < words)
+            size = words;
+        const Word **grown = new const Word *[size];
+        if (total && tunsorted)
+            memcpy(grown, tunsorted, total * sizeof(const Word *));
+        delete[] tunsorted;
+        tunsorted = grown;
+        tunsortedSize = size;
+    }
+    if (lines > LinesSize)
+    {
+        unsigned long int size = 2 * LinesSize;
+        if (size < lines)
+            size = lines;
+        unsigned long int *grown = new unsigned long int[size];
+        if (LinesSize)
+            memcpy(grown, Lines, LinesSize * sizeof(unsigned long int));
+        memset(grown + LinesSize, 0, (size - LinesSize) * sizeof(unsigned long int));
+        delete[] Lines;
+        Lines = grown;
+        LinesSize = size;
+    }
+}
+
 void text::createUnTaggedAlternatives(
 #ifndef CONSTSTRCHR
     const
@@ -939,12 +1475,13 @@ void text::createTagged(const char *w, const char *tag)
 }
 
 text::text(bool a_InputHasTags, bool nice)
-    : Root(0), lineno(0), total(0), reducedtotal(0), fields(0), basefrmarrD(0), basefrmarrL(0), InputHasTags(a_InputHasTags)
+    : Types(0), Root(0), tunsorted(0), Lines(0), tunsortedSize(0), LinesSize(0), lineno(0), total(0), reducedtotal(0), fields(0), basefrmarrD(0), basefrmarrL(0), basefrmarrDSize(0), basefrmarrLSize(0), InputHasTags(a_InputHasTags)
 
 {
 #ifdef COUNTOBJECTS
     ++COUNT;
 #endif
+    arena::current = &Arena;
     if (nice)
         LOG1LINE("counting words");
 }
@@ -952,24 +1489,120 @@ text::text(bool a_InputHasTags, bool nice)
 text::~text()
 {
     delete fields;
-    delete Root;
+    delete Types;
+    delete[] tunsorted;
+    delete[] Lines;
+    delete[] basefrmarrD;
+    delete[] basefrmarrL;
 #ifdef COUNTOBJECTS
     --COUNT;
 #endif
 }
 
+/* The words, their lemmas and their strings are in the text's arena. They
+   are not deleted one by one, but released with the arena. */
+void text::releaseWords()
+{
+    Root = 0;
+    N = 0;
+    if (Types)
+        Types->clear();
+    Arena.release();
+}
+
+/* Make the text empty, so that it can be used for the next input, as
+   LemmatiseString does. The words are released. The arrays and the type
+   table keep their capacity, unless it exceeds keep elements (-Q). */
+void text::clear(unsigned long int keep)
+{
+    releaseWords();
+    arena::current = &Arena;
+    if (Types && Types->capacity() > keep)
+    {
+        delete Types;
+        Types = 0;
+    }
+    if (tunsortedSize > keep)
+    {
+        delete[] tunsorted;
+        tunsorted = 0;
+        tunsortedSize = 0;
+    }
+    if (LinesSize > keep)
+    {
+        delete[] Lines;
+        Lines = 0;
+        LinesSize = 0;
+    }
+    else if (LinesSize)
+        memset(Lines, 0, (lineno < LinesSize ? lineno + 1 : LinesSize) * sizeof(unsigned long int));
+    if (basefrmarrDSize > keep)
+    {
+        delete[] basefrmarrD;
+        basefrmarrD = 0;
+        basefrmarrDSize = 0;
+    }
+    if (basefrmarrLSize > keep)
+    {
+        delete[] basefrmarrL;
+        basefrmarrL = 0;
+        basefrmarrLSize = 0;
+    }
+    lineno = 0;
+    total = 0;
+    reducedtotal = 0;
+    StartOfLine = true;
+}
+
 bool text::setFormat(const char *cformat, const char *bformat, const char *Bformat, bool a_InputHasTags)
 {
     return Word::setFormat(cformat, bformat, Bformat, a_InputHasTags);
 }
 
-void text::makeList()
+/* The key of a type for -S: the word, followed by the tag if there is one. */
+static std::string typeKey(const Word *wrd)
 {
-    if (Hash)
+    std::string key(wrd->m_word);
+    if (wrd->m_tag)
     {
-        Root = Hash->convertToList(N);
-        delete Hash;
-        Hash = NULL;
+        key += '\t';
+        key += wrd->m_tag;
     }
+    return key;
+}
+
+/* For -S. Adds the capitalised types of this chunk that occur inside a line.
+   In the whole input, these types are not segment initial. */
+void text::typesInsideLines(std::unordered_set<std::string> &keys) const
+{
+    if (Root)
+        for (size_t i = 0; i < N; ++i)
+            if (!Root[i]->segmentInitial() && isUpperUTF8(Root[i]->m_word))
+                keys.insert(typeKey(Root[i]));
+}
+
+/* For -S. A type that only occurs at line starts in this chunk is not
+   segment initial if it occurs inside a line in another chunk. */
+void text::notSegmentInitial(const std::unordered_set<std::string> &keys)
+{
+    if (Root)
+        for (size_t i = 0; i < N; ++i)
+            if (Root[i]->segmentInitial() && keys.count(typeKey(Root[i])))
+                Root[i]->unsetSegmentInitial();
+}
+
+/* For -j. Writes a line for each looked up type: 'u' if it is unknown,
+   'c' if it is conflicting, '-' otherwise, a tab and the type's key. */
+void text::writeTypes(FILE *fp) const
+{
+    if (Root)
+        for (size_t i = 0; i < N; ++i)
+            fprintf(fp, "%c\t%s\n", Root[i]->unknown() ? 'u' : Root[i]->conflicting() ? 'c' : '-', typeKey(Root[i]).c_str());
+}
+
+void text::makeList()
+{
+    if (Types)
+        Root = Types->list(N);
 }
 #endif
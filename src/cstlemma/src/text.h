@@ -25,8 +25,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "defines.h"
 #if defined PROGLEMMATISE
 
+#include "arena.h"
 #include <stdio.h>
 #include <string>
+#include <unordered_set>
 
 class Word;
 class taggedWord;
@@ -54,12 +56,17 @@ struct tallyStruct
 };
 
 class field;
+class typeTable;
 
 class text
 {
 private:
     basefrm **basefrmarrD;
     basefrm **basefrmarrL;
+    unsigned long int basefrmarrDSize; // number of allocated elements
+    unsigned long int basefrmarrLSize; // number of allocated elements
+    arena Arena; // the words, their lemmas and their strings
+    typeTable *Types; // the words, by word and tag; owns the array Root
 
 public:
     basefrm **ppD;
@@ -75,6 +82,8 @@ protected:
     Word **Root;
     const Word **tunsorted;
     unsigned long int *Lines;
+    unsigned long int tunsortedSize; // number of allocated elements
+    unsigned long int LinesSize;     // number of allocated elements
     field *fields;
     size_t N;
     unsigned long int lineno;
@@ -84,6 +93,9 @@ protected:
     bool StartOfLine;
 
 private:
+    void lookupWords();
+    void allocBaseforms(int D, int L);
+    void releaseWords();
     virtual const char *convert(const char *s, char *buf, const char *lastBufByte) = 0;
 
 protected:
@@ -91,9 +103,11 @@ protected:
     void insert(const char *w);
     void insert(const char *w, const char *tag);
     void AddField(field *fld);
+    void reserve(unsigned long int words, unsigned long int lines);
     field *translateFormat(char *Iformat, field *&wordfield, field *&tagfield);
 
 public:
+    static int SortThreads; // number of threads that sort the words and lemmas (-J)
     void incTotal()
     {
         ++total;
@@ -102,6 +116,10 @@ public:
     {
         total += inc;
     }
+    unsigned long int words() const
+    {
+        return total;
+    }
     static bool setFormat(const char *format, const char *bformat, const char *Bformat, bool InputHasTags);
     void Lemmatise(FILE *fpo, const char *Sep, tallyStruct *tally, unsigned int SortOutput, int UseLemmaFreqForDisambiguation, bool nice, bool DictUnique, bool RulesUnique, enum caseTp baseformsAreLowercase, int listLemmas, bool mergeLemmas);
     std::string Lemmatise(const char *Sep, tallyStruct *tally, unsigned int SortOutput, int UseLemmaFreqForDisambiguation, bool nice, bool DictUnique, bool RulesUnique, enum caseTp baseformsAreLowercase, int listLemmas, bool mergeLemmas);
@@ -116,6 +134,10 @@ public:
     virtual void printUnsorted(FILE *fpo) = 0;
     virtual void writeUnsorted(std::string &str) = 0;
     void makeList();
+    void clear(unsigned long int keep);
+    void typesInsideLines(std::unordered_set<std::string> &keys) const;
+    void notSegmentInitial(const std::unordered_set<std::string> &keys);
+    void writeTypes(FILE *fp) const;
 };
 
 extern char *globIformat;
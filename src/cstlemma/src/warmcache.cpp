@@ -0,0 +1,618 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+#include "warmcache.h"
+#if defined PROGLEMMATISE
+
+#include "word.h"
+#include "text.h"
+#include "basefrm.h"
+#include "basefrmpntr.h"
+#include "dictionary.h"
+#include "lemmatiser.h"
+#include "flex.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#if !defined _WIN32
+#include <sys/mman.h>
+#endif
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+
+#define MODELHASHINIT 14695981039346656037ULL
+
+static std::string MODELFILES[7];  // setModel. [0] is the flex file.
+static bool HASMODELFILE[7];
+static bool MODELHASHED = false;
+static tmodelhash MODEL = MODELHASHINIT; // hash of the model files
+
+static char * IMAGE = NULL;
+static size_t IMAGESIZE = 0;
+static bool IMAGEMAPPED = false;
+static const twarmheader * HEADER = NULL;
+static const INT32 * SLOTS = NULL;
+static const twarmentry * ENTRIES = NULL;
+static const twarmcandidate * CANDIDATES = NULL;
+static const char * STRINGS = NULL;
+static unsigned long PROBES = 0;
+static unsigned long HITS = 0;
+
+/* What a key's look-up produced, and how often the key was seen. The key is
+   the entry flags byte (WE_TAGGED | WE_SEGMENTINITIAL), the word, '\0' and
+   the tag. */
+struct observation
+    {
+    unsigned long count;
+    unsigned char flags;
+    unsigned char nD;
+    unsigned char nL;
+    unsigned char cntD;
+    unsigned char cntL;
+    std::vector<std::string> strings; // lemma, tag, lemma, tag, ...
+    };
+
+typedef std::unordered_map<std::string,observation> tobservations;
+static tobservations * OBSERVED = NULL;
+static size_t KEEP = 0;            // prune OBSERVED down to the 2 * KEEP most frequent
+static int RECORDSETTINGS = -1;    // settings of the first observation
+static bool REUSE = false;         // replay OBSERVED too
+
+static tmodelhash hashBytes(tmodelhash h,const char * s,size_t n)
+    {
+    for(size_t i = 0;i < n;++i)
+        h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+    return h;
+    }
+
+/* Fold the contents of a file into h. A missing file counts as one zero
+   byte, so that it differs from an empty file. */
+static tmodelhash hashFile(tmodelhash h,const char * name)
+    {
+    FILE * fp = name ? fopen(name,"rb") : NULL;
+    if(!fp)
+        return hashBytes(h,"",1);
+    char buf[65536];
+    size_t n;
+    while((n = fread(buf,1,sizeof(buf),fp)) > 0)
+        h = hashBytes(h,buf,n);
+    fclose(fp);
+    return hashBytes(h,"\1",1);
+    }
+
+/* The model hash, including the tag specific rule files (flexfile.tag) for
+   the given (text) tags. */
+static tmodelhash modelHash(const std::set<std::string> & tags)
+    {
+    if(!MODELHASHED)
+        { // Not done in setModel, because hashing a big dictionary takes time.
+        MODEL = MODELHASHINIT;
+        for(int i = 0;i < 6;++i)
+            MODEL = hashFile(MODEL,HASMODELFILE[i] ? MODELFILES[i].c_str() : NULL);
+        MODEL = hashBytes(MODEL,MODELFILES[6].c_str(),MODELFILES[6].size() + 1);
+        MODELHASHED = true;
+        }
+    tmodelhash h = MODEL;
+    if(HASMODELFILE[0])
+        {
+        std::set<std::string> ttags;
+        for(std::set<std::string>::const_iterator t = tags.begin();t != tags.end();++t)
+            ttags.insert(Lemmatiser::translate(t->c_str()));
+        for(std::set<std::string>::const_iterator t = ttags.begin();t != ttags.end();++t)
+            {
+            std::string name = MODELFILES[0] + "." + *t;
+            h = hashBytes(h,t->c_str(),t->size() + 1);
+            h = hashFile(h,name.c_str());
+            }
+        }
+    return h;
+    }
+
+static int settings()
+    {
+    return (Word::DictUnique ? 1 : 0) | (Word::RulesUnique ? 2 : 0) | ((int)flex::baseformsAreLowercase << 2);
+    }
+
+static unsigned int keyHash(const char * word,const char * tag,unsigned char flags)
+    {
+    unsigned int h = 2166136261u; // FNV-1a
+    h = (h ^ flags) * 16777619u;
+    for(const char * s = word;*s;++s)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    if(tag)
+        {
+        h = h * 16777619u; // the '\0' between word and tag
+        for(const char * s = tag;*s;++s)
+            h = (h ^ (unsigned char)*s) * 16777619u;
+        }
+    return h;
+    }
+
+static unsigned char keyFlags(const Word * w)
+    {
+    return (unsigned char)((w->m_tag ? WE_TAGGED : 0) | (w->segmentInitial() ? WE_SEGMENTINITIAL : 0));
+    }
+
+static void unload()
+    {
+    if(IMAGE)
+        {
+#if !defined _WIN32
+        if(IMAGEMAPPED)
+            munmap(IMAGE,IMAGESIZE);
+        else
+#endif
+            free(IMAGE);
+        }
+    IMAGE = NULL;
+    IMAGESIZE = 0;
+    IMAGEMAPPED = false;
+    HEADER = NULL;
+    SLOTS = NULL;
+    ENTRIES = NULL;
+    CANDIDATES = NULL;
+    STRINGS = NULL;
+    }
+
+void warmcache::setModel(const char * flexfile,const char * dictfile,const char * delta,const char * v,const char * x,const char * z,const char * encoding)
+    {
+    const char * files[7] = {flexfile,dictfile,delta,v,x,z,encoding};
+    for(int i = 0;i < 7;++i)
+        {
+        HASMODELFILE[i] = files[i] != NULL;
+        MODELFILES[i] = files[i] ? files[i] : "";
+        }
+    MODELHASHED = false;
+    }
+
+bool warmcache::load(const char * filename)
+    {
+    unload();
+    FILE * fp = fopen(filename,"rb");
+    if(!fp)
+        {
+        fprintf(stderr,"Warm cache: cannot open %s.\n",filename);
+        return false;
+        }
+    if(FSEEK(fp,0,SEEK_END) != 0)
+        {
+        fclose(fp);
+        return false;
+        }
+    LONG size = FTELL(fp);
+    if(size < (LONG)sizeof(twarmheader))
+        {
+        fprintf(stderr,"Warm cache: %s is too short.\n",filename);
+        fclose(fp);
+        return false;
+        }
+    IMAGESIZE = (size_t)size;
+#if !defined _WIN32
+    IMAGE = (char *)mmap(NULL,IMAGESIZE,PROT_READ,MAP_PRIVATE,fileno(fp),0);
+    if(IMAGE == MAP_FAILED)
+        IMAGE = NULL;
+    else
+        IMAGEMAPPED = true;
+#endif
+    if(!IMAGE)
+        {
+        IMAGE = (char *)malloc(IMAGESIZE);
+        rewind(fp);
+        if(!IMAGE || fread(IMAGE,IMAGESIZE,1,fp) != 1)
+            {
+            fprintf(stderr,"Warm cache: cannot read %s.\n",filename);
+            fclose(fp);
+            unload();
+            return false;
+            }
+        }
+    fclose(fp);
+    const twarmheader * header = (const twarmheader *)IMAGE;
+    size_t need = sizeof(twarmheader)
+                + (size_t)header->nslots * sizeof(INT32)
+                + (size_t)header->nentries * sizeof(twarmentry)
+                + (size_t)header->ncandidates * sizeof(twarmcandidate)
+                + (size_t)header->nstrings;
+    if(  memcmp(header->magic,WARMMAGIC,sizeof(header->magic))
+      || header->version != WARMVERSION
+      || header->byteorder != DICTBYTEORDER
+      || header->nslots <= 0
+      || (header->nslots & (header->nslots - 1))
+      || header->nentries < 0
+      || header->nentries >= header->nslots
+      || header->ncandidates < 0
+      || header->nstrings <= 0
+      || need > IMAGESIZE
+      )
+        {
+        fprintf(stderr,"Warm cache: %s is not a warm cache file of version %d.\n",filename,WARMVERSION);
+        unload();
+        return false;
+        }
+    SLOTS = (const INT32 *)(header + 1);
+    ENTRIES = (const twarmentry *)(SLOTS + header->nslots);
+    CANDIDATES = (const twarmcandidate *)(ENTRIES + header->nentries);
+    STRINGS = (const char *)(CANDIDATES + header->ncandidates);
+    bool ok = STRINGS[header->nstrings - 1] == '\0';
+    for(INT32 s = 0;ok && s < header->nslots;++s)
+        ok = SLOTS[s] >= 0 && SLOTS[s] <= header->nentries;
+    std::set<std::string> tags;
+    for(INT32 i = 0;ok && i < header->nentries;++i)
+        {
+        const twarmentry & e = ENTRIES[i];
+        ok =  e.word >= 0 && e.word < header->nstrings
+           && e.tag >= 0 && e.tag < header->nstrings
+           && e.first >= 0 && e.first + e.nD + e.nL <= header->ncandidates;
+        for(int c = 0;ok && c < e.nD + e.nL;++c)
+            {
+            const twarmcandidate & cand = CANDIDATES[e.first + c];
+            ok =  cand.lemma >= 0 && cand.lemma < header->nstrings
+               && cand.tag >= 0 && cand.tag < header->nstrings;
+            }
+        if(ok && (e.flags & WE_TAGGED))
+            tags.insert(STRINGS + e.tag);
+        }
+    if(!ok)
+        {
+        fprintf(stderr,"Warm cache: %s is corrupt.\n",filename);
+        unload();
+        return false;
+        }
+    if(header->modelhash != modelHash(tags))
+        {
+        fprintf(stderr,"Warm cache: %s was made with other model files. Not used.\n",filename);
+        unload();
+        return false;
+        }
+    HEADER = header;
+    PROBES = HITS = 0;
+    return true;
+    }
+
+void warmcache::record(size_t ntypes)
+    {
+    if(!OBSERVED)
+        OBSERVED = new tobservations;
+    KEEP = ntypes > 1024 ? ntypes : 1024;
+    }
+
+void warmcache::reuse(size_t ntypes)
+    {
+    if(ntypes < KEEP)
+        ntypes = KEEP;
+    record(ntypes);
+    REUSE = true;
+    }
+
+static bool moreFrequent(const tobservations::value_type * a,const tobservations::value_type * b)
+    {
+    if(a->second.count != b->second.count)
+        return a->second.count > b->second.count;
+    return a->first < b->first;
+    }
+
+bool warmcache::write(const char * filename,size_t ntypes)
+    {
+    if(!OBSERVED)
+        {
+        fprintf(stderr,"Warm cache: no look-ups were recorded.\n");
+        return false;
+        }
+    std::vector<const tobservations::value_type *> top;
+    top.reserve(OBSERVED->size());
+    for(tobservations::const_iterator o = OBSERVED->begin();o != OBSERVED->end();++o)
+        top.push_back(&*o);
+    std::sort(top.begin(),top.end(),moreFrequent);
+    if(top.size() > ntypes)
+        top.resize(ntypes);
+
+    std::string strings(1,'\0');
+    std::unordered_map<std::string,INT32> stringIndex;
+    stringIndex[std::string()] = 0;
+    std::vector<twarmentry> entries;
+    std::vector<twarmcandidate> candidates;
+    std::set<std::string> tags;
+    INT32 nslots = 1;
+    while(nslots < 2 * (INT32)top.size() + 1)
+        nslots *= 2;
+    std::vector<INT32> slots(nslots,0);
+    for(size_t i = 0;i < top.size();++i)
+        {
+        const std::string & key = top[i]->first;
+        const observation & o = top[i]->second;
+        const char * word = key.c_str() + 1;
+        const char * tag = word + strlen(word) + 1;
+        std::string fields[2] = {word,tag};
+        INT32 index[2];
+        for(int f = 0;f < 2;++f)
+            {
+            std::unordered_map<std::string,INT32>::const_iterator s = stringIndex.find(fields[f]);
+            if(s == stringIndex.end())
+                {
+                index[f] = (INT32)strings.size();
+                stringIndex[fields[f]] = index[f];
+                strings.append(fields[f]);
+                strings.push_back('\0');
+                }
+            else
+                index[f] = s->second;
+            }
+        twarmentry e;
+        e.word = index[0];
+        e.tag = index[1];
+        e.first = (INT32)candidates.size();
+        e.flags = o.flags;
+        e.nD = o.nD;
+        e.nL = o.nL;
+        e.cntD = o.cntD;
+        e.cntL = o.cntL;
+        for(size_t c = 0;c < o.strings.size();c += 2)
+            {
+            twarmcandidate cand;
+            INT32 * field[2] = {&cand.lemma,&cand.tag};
+            for(int f = 0;f < 2;++f)
+                {
+                std::unordered_map<std::string,INT32>::const_iterator s = stringIndex.find(o.strings[c + f]);
+                if(s == stringIndex.end())
+                    {
+                    *field[f] = (INT32)strings.size();
+                    stringIndex[o.strings[c + f]] = *field[f];
+                    strings.append(o.strings[c + f]);
+                    strings.push_back('\0');
+                    }
+                else
+                    *field[f] = s->second;
+                }
+            candidates.push_back(cand);
+            }
+        if(o.flags & WE_TAGGED)
+            tags.insert(tag);
+        unsigned int h = keyHash(word,(o.flags & WE_TAGGED) ? tag : NULL,(unsigned char)(o.flags & (WE_TAGGED | WE_SEGMENTINITIAL)));
+        INT32 s = (INT32)(h & (nslots - 1));
+        while(slots[s])
+            s = (s + 1) & (nslots - 1);
+        slots[s] = (INT32)entries.size() + 1;
+        entries.push_back(e);
+        }
+
+    twarmheader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,WARMMAGIC,sizeof(header.magic));
+    header.version = WARMVERSION;
+    header.byteorder = DICTBYTEORDER;
+    header.modelhash = modelHash(tags);
+    header.settings = RECORDSETTINGS < 0 ? settings() : RECORDSETTINGS;
+    header.nslots = nslots;
+    header.nentries = (INT32)entries.size();
+    header.ncandidates = (INT32)candidates.size();
+    header.nstrings = (INT32)strings.size();
+
+    FILE * fp = fopen(filename,"wb");
+    if(!fp)
+        {
+        fprintf(stderr,"Warm cache: cannot open %s for writing.\n",filename);
+        return false;
+        }
+    bool ok =  fwrite(&header,sizeof(header),1,fp) == 1
+            && fwrite(&slots[0],sizeof(INT32),slots.size(),fp) == slots.size()
+            && (entries.empty() || fwrite(&entries[0],sizeof(twarmentry),entries.size(),fp) == entries.size())
+            && (candidates.empty() || fwrite(&candidates[0],sizeof(twarmcandidate),candidates.size(),fp) == candidates.size())
+            && fwrite(strings.c_str(),1,strings.size(),fp) == strings.size();
+    if(fclose(fp) != 0 || !ok)
+        {
+        fprintf(stderr,"Warm cache: cannot write %s.\n",filename);
+        return false;
+        }
+    return true;
+    }
+
+#if WARMCACHE
+static void add(baseformpointer *& bfp,const char * s,const char * t)
+    {
+    if(bfp)
+        bfp->addBaseForm(s,t,strlen(s));
+    else
+        bfp = new baseformpointer(s,t,strlen(s));
+    }
+
+/* What Word::lookup adds to the text's statistics. */
+static void account(text * txt,unsigned char flags,int cnt,int cntD,int cntL)
+    {
+    if(flags & WE_CONFLICT)
+        {
+        txt->aConflictTypes++;
+        txt->aConflict += cnt;
+        }
+    if(flags & WE_UNKNOWN)
+        {
+        txt->newcntTypes++;
+        txt->newcnt += cnt;
+        }
+    txt->cntD += cntD;
+    txt->cntL += cntL;
+    }
+
+static std::string observationKey(const Word * w,unsigned char flags)
+    {
+    std::string key(1,(char)flags);
+    key.append(w->m_word);
+    key.push_back('\0');
+    if(w->m_tag)
+        key.append(w->m_tag);
+    return key;
+    }
+
+/* If the cache file has w's key, do what Word::lookup would do and return
+   true. With reuse(), the keys that this run has recorded are tried next. */
+bool warmcache::replay(Word * w,text * txt)
+    {
+    bool file = HEADER && HEADER->settings == settings();
+    if((!file && !(REUSE && OBSERVED)) || dictionary::loading())
+        return false;
+    ++PROBES;
+    unsigned char flags = keyFlags(w);
+    const twarmentry * e = NULL;
+    if(file)
+        {
+        INT32 mask = HEADER->nslots - 1;
+        INT32 s = (INT32)(keyHash(w->m_word,w->m_tag,flags) & mask);
+        for(;SLOTS[s];s = (s + 1) & mask)
+            {
+            const twarmentry * c = ENTRIES + SLOTS[s] - 1;
+            if(  (c->flags & (WE_TAGGED | WE_SEGMENTINITIAL)) == flags
+              && !strcmp(STRINGS + c->word,w->m_word)
+              && (!w->m_tag || !strcmp(STRINGS + c->tag,w->m_tag))
+              )
+                {
+                e = c;
+                break;
+                }
+            }
+        }
+    if(e)
+        {
+        const twarmcandidate * cand = CANDIDATES + e->first;
+        for(int i = 0;i < e->nD;++i,++cand)
+            add(w->pbfD,STRINGS + cand->lemma,STRINGS + cand->tag);
+        for(int i = 0;i < e->nL;++i,++cand)
+            add(w->pbfL,STRINGS + cand->lemma,STRINGS + cand->tag);
+        if(e->flags & WE_FOUNDINDICT)
+            w->FoundInDict = true;
+        account(txt,e->flags,w->itsCnt(),e->cntD,e->cntL);
+        observe(w,(e->flags & WE_UNKNOWN) != 0,(e->flags & WE_CONFLICT) != 0,e->cntD,e->cntL);
+        }
+    else
+        {
+        if(!REUSE || !OBSERVED || RECORDSETTINGS != settings())
+            return false;
+        tobservations::iterator o = OBSERVED->find(observationKey(w,flags));
+        if(o == OBSERVED->end())
+            return false;
+        observation & obs = o->second;
+        size_t c = 0;
+        for(int i = 0;i < obs.nD;++i,c += 2)
+            add(w->pbfD,obs.strings[c].c_str(),obs.strings[c + 1].c_str());
+        for(int i = 0;i < obs.nL;++i,c += 2)
+            add(w->pbfL,obs.strings[c].c_str(),obs.strings[c + 1].c_str());
+        if(obs.flags & WE_FOUNDINDICT)
+            w->FoundInDict = true;
+        account(txt,obs.flags,w->itsCnt(),obs.cntD,obs.cntL);
+        obs.count += w->itsCnt(); // what observe() would do
+        }
+    ++HITS;
+    return true;
+    }
+
+static int snapshot(const baseformpointer * bfp,std::vector<std::string> & strings)
+    {
+    int n = 0;
+    for(;bfp;bfp = bfp->nextPointer(),++n)
+        {
+        strings.push_back(bfp->baseform()->source());
+        strings.push_back(bfp->baseform()->itsTag());
+        }
+    return n;
+    }
+
+/* Count w's key and, the first time it is seen, remember the outcome of its
+   look-up. Look-ups while the dictionary is still being loaded are not
+   recorded. */
+void warmcache::observe(const Word * w,bool unknown,bool conflict,int cntD,int cntL)
+    {
+    if(!OBSERVED || dictionary::loading())
+        return;
+    int current = settings();
+    if(RECORDSETTINGS < 0)
+        RECORDSETTINGS = current;
+    else if(RECORDSETTINGS != current)
+        return;
+    unsigned char flags = keyFlags(w);
+    std::string key = observationKey(w,flags);
+    tobservations::iterator o = OBSERVED->find(key);
+    if(o != OBSERVED->end())
+        {
+        o->second.count += w->itsCnt();
+        return;
+        }
+    observation obs;
+    obs.count = w->itsCnt();
+    int nD = snapshot(w->pbfD,obs.strings);
+    int nL = snapshot(w->pbfL,obs.strings);
+    if(nD > 255 || nL > 255 || cntD < 0 || cntD > 255 || cntL < 0 || cntL > 255)
+        return; // doesn't fit in an entry
+    obs.flags = (unsigned char)(flags 
+                               | (w->FoundInDict ? WE_FOUNDINDICT : 0)
+                               | (conflict ? WE_CONFLICT : 0)
+                               | (unknown ? WE_UNKNOWN : 0)
+                               );
+    obs.nD = (unsigned char)nD;
+    obs.nL = (unsigned char)nL;
+    obs.cntD = (unsigned char)cntD;
+    obs.cntL = (unsigned char)cntL;
+    (*OBSERVED)[key] = obs;
+    if(OBSERVED->size() > 4 * KEEP)
+        { // Forget the least frequent keys.
+        std::vector<const tobservations::value_type *> all;
+        all.reserve(OBSERVED->size());
+        for(tobservations::const_iterator i = OBSERVED->begin();i != OBSERVED->end();++i)
+            all.push_back(&*i);
+        std::nth_element(all.begin(),all.begin() + 2 * KEEP,all.end(),moreFrequent);
+        std::vector<std::string> forget;
+        for(size_t i = 2 * KEEP;i < all.size();++i)
+            forget.push_back(all[i]->first);
+        for(size_t i = 0;i < forget.size();++i)
+            OBSERVED->erase(forget[i]);
+        }
+    }
+#endif
+
+/* Number of probes and hits since the cache was loaded. False if no cache
+   is in use. */
+bool warmcache::statistics(unsigned long & probes,unsigned long & hits)
+    {
+    if(!HEADER && !REUSE)
+        return false;
+    probes = PROBES;
+    hits = HITS;
+    return true;
+    }
+
+/* Count the probes and hits of another process (-j). */
+void warmcache::addStatistics(unsigned long probes,unsigned long hits)
+    {
+    PROBES += probes;
+    HITS += hits;
+    }
+
+void warmcache::clear()
+    {
+    unload();
+    delete OBSERVED;
+    OBSERVED = NULL;
+    KEEP = 0;
+    RECORDSETTINGS = -1;
+    REUSE = false;
+    PROBES = HITS = 0;
+    }
+#endif
@@ -0,0 +1,132 @@
+/*
+CSTLEMMA - trainable lemmatiser
+
+Copyright (C) 2002, 2014  Center for Sprogteknologi, University of Copenhagen
+
+This file is part of CSTLEMMA.
+
+CSTLEMMA is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+CSTLEMMA is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with CSTLEMMA; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+#ifndef WARMCACHE_H
+#define WARMCACHE_H
+
+#include "defines.h"
+#if defined PROGLEMMATISE
+#include "lem.h"
+#include <stddef.h>
+
+class Word;
+class text;
+
+/*
+Warm cache: the outcome of Word::lookup (the candidate lemmas from the
+dictionary and from the rules, and what the look-up adds to the text's
+statistics) for the most frequent (word, tag, segment initial) keys that an
+earlier run has seen. Word::lookup probes the cache before it does any
+dictionary or rule work.
+The file is tied to the model: a hash of the contents of the rule,
+dictionary, delta dictionary and tag files (and of the tag specific rule
+files of the cached tags). A cache made with other model files is rejected when it is read.
+The cache is only used with the DictUnique, RulesUnique and lower case
+settings that it was made with.
+
+File layout, native byte order, usable as it is when mapped into memory:
+
+    twarmheader, INT32 slot[nslots], twarmentry entry[nentries],
+    twarmcandidate candidate[ncandidates], char strings[nstrings]
+
+slot[] is an open addressing hash table (linear probing) of entry indices
+plus one, 0 if empty. Entry e has the candidates from e.first up to
+e.first + e.nD + e.nL: first the dictionary's, then the rules'.
+Strings are zero terminated. Index 0 is the empty string.
+*/
+#define WARMMAGIC "CSTLWARM"
+#define WARMVERSION 1
+#define WARMDEFAULTSIZE 50000
+
+/* The cache doesn't keep the dictionary frequencies that PFRQ and FREQ24
+   builds attach to base forms. It is not used in those builds. */
+#define WARMCACHE (!PFRQ && !FREQ24)
+
+typedef unsigned long long tmodelhash;
+
+enum warmEntryFlags
+    {
+    WE_TAGGED = 1,         // key has a tag (taggedWord)
+    WE_SEGMENTINITIAL = 2, // key is segment initial
+    WE_FOUNDINDICT = 4,    // Word::FoundInDict
+    WE_CONFLICT = 8,       // counts as conflicting (text::aConflict)
+    WE_UNKNOWN = 16        // not in the dictionary (text::newcnt)
+    };
+
+typedef struct
+    {
+    INT32 word;          // index in strings
+    INT32 tag;           // index in strings, 0 if not WE_TAGGED
+    INT32 first;         // index of first candidate
+    unsigned char flags; // warmEntryFlags
+    unsigned char nD;    // number of candidates from the dictionary
+    unsigned char nL;    // number of candidates from the rules
+    unsigned char cntD;  // what the look-up adds to text::cntD
+    unsigned char cntL;  // and to text::cntL
+    } twarmentry;
+
+typedef struct
+    {
+    INT32 lemma; // index in strings. Rule lemmas: lemma\vpattern\vreplacement
+    INT32 tag;   // index in strings
+    } twarmcandidate;
+
+typedef struct
+    {
+    char magic[8];        // WARMMAGIC, not zero terminated
+    INT32 version;        // WARMVERSION
+    INT32 byteorder;      // DICTBYTEORDER
+    tmodelhash modelhash;
+    INT32 settings;       // DictUnique, RulesUnique and lower case settings
+    INT32 nslots;         // power of two
+    INT32 nentries;
+    INT32 ncandidates;
+    INT32 nstrings;
+    } twarmheader;
+
+class warmcache
+    {
+    public:
+        // Model files. Call before load, write and record.
+        static void setModel(const char * flexfile,const char * dictfile,const char * delta,const char * v,const char * x,const char * z,const char * encoding);
+        static bool load(const char * filename);
+        // Record the keys that look-ups see, keeping at least the
+        // ntypes most frequent ones.
+        static void record(size_t ntypes);
+        // Also replay the recorded keys, so that a key is looked up only
+        // once while it is among the most frequent ones (lemmatising in
+        // chunks, -S).
+        static void reuse(size_t ntypes);
+        static bool write(const char * filename,size_t ntypes);
+#if WARMCACHE
+        static bool replay(Word * w,text * txt);
+        static void observe(const Word * w,bool unknown,bool conflict,int cntD,int cntL);
+#else
+        static bool replay(Word *,text *){return false;}
+        static void observe(const Word *,bool,bool,int,int){}
+#endif
+        static bool statistics(unsigned long & probes,unsigned long & hits);
+        static void addStatistics(unsigned long probes,unsigned long hits);
+        static void clear();
+    };
+
+#endif
+#endif
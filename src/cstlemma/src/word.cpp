@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "lemmatiser.h"
 #include "text.h"
 #include "dictionary.h"
+#include "warmcache.h"
 #include "utf8func.h"
 #include <assert.h>
 #include <stdlib.h>
@@ -283,12 +284,35 @@ int Word::addBaseFormsDL(lext *Plext, int nmbr, // The dictionary's available
 #if WRIT
     int written = 0;
 #endif
-    unsigned int maxFreq = maxFrequency(Plext, nmbr, 0, n);
+    // Use the dictionary's precomputed disambiguation data, if it has any.
+    const tleafinfo *info = Word::DictUnique && nmbr > 1 ? dictionary::leafInfo(Plext) : 0;
+    unsigned int maxFreq;
+    if (info)
+    {
+        maxFreq = info->S.frequency;
+        n = info->nmax;
+    }
+    else
+        maxFreq = maxFrequency(Plext, nmbr, 0, n);
     if (n > 1)
     {
-        const char *tp = commonType(Plext, nmbr, maxFreq);
-        unsigned int off;
-        char *stem = commonStem(Plext, nmbr, tp, maxFreq, off);
+        const char *tp;
+        char *stem;
+        if (info)
+        {   // With a lemma tag file, readings with different types can
+            // still have the same lemma tag.
+            if (hasLemmaTags())
+                tp = commonType(Plext, nmbr, maxFreq);
+            else
+                tp = info->iType < 0 ? 0 : lext::Strings + info->iType;
+            stem = info->iStemSuffix < 0 ? 0 : this->stem(info->S.Offset, lext::Strings + info->iStemSuffix);
+        }
+        else
+        {
+            tp = commonType(Plext, nmbr, maxFreq);
+            unsigned int off;
+            stem = commonStem(Plext, nmbr, tp, maxFreq, off);
+        }
         if (tp)
         {
             if (stem)
@@ -336,9 +360,9 @@ int Word::addBaseFormsDL(lext *Plext, int nmbr, // The dictionary's available
         if (plext->S.frequency >= maxFreq)
         {
 #if PFRQ || FREQ24
-            cntD += addBaseFormD(plext->constructBaseform(m_word), LemmaTag(plext->Type), plext->S.frequency);
+            cntD += addBaseFormD(plext->constructBaseform(m_word), LemmaTag(plext->Type()), plext->S.frequency);
 #else
-            cntD += addBaseFormD(plext->constructBaseform(m_word), LemmaTag(plext->Type));
+            cntD += addBaseFormD(plext->constructBaseform(m_word), LemmaTag(plext->Type()));
 #endif
             FoundInDict = true;
 #if WRIT
@@ -421,7 +445,7 @@ unsigned int Word::maxFrequency(lext *Plext, int nmbr, const char *a_type, int &
     unsigned int maxfreq = 0;
     for (int j = 0; j < nmbr; ++j)
     {
-        if (!a_type || !strcmp(a_type, LemmaTag(Plext[j].Type)))
+        if (!a_type || !strcmp(a_type, LemmaTag(Plext[j].Type())))
         {
             if (Plext[j].S.frequency > maxfreq)
             {
@@ -444,22 +468,20 @@ char *Word::commonStem(lext *Plext, int nmbr, const char *a_type, unsigned int f
         return 0;
     if (nmbr < 2)
         return 0;
-    static char buf[256];
     char suffix[256];
     suffix[0] = '\0';
-    buf[0] = '\0';
     off = 0;
     char *ret = 0;
     int ii;
     for (ii = 0; ii < nmbr; ++ii)
     {
-        if (freq == Plext[ii].S.frequency && (!a_type || !strcmp(a_type, LemmaTag(Plext[ii].Type))))
+        if (freq == Plext[ii].S.frequency && (!a_type || !strcmp(a_type, LemmaTag(Plext[ii].Type()))))
         {
             if (ret && off != Plext[ii].S.Offset)
             {
                 return 0;
             }
-            char *bf = Plext[ii].BaseFormSuffix;
+            const char *bf = Plext[ii].BaseFormSuffix();
             if (suffix[0])
             {
                 if (strcmp(suffix, bf))
@@ -475,6 +497,12 @@ char *Word::commonStem(lext *Plext, int nmbr, const char *a_type, unsigned int f
             }
         }
     }
+    return stem(off, suffix);
+}
+
+char *Word::stem(unsigned int off, const char *suffix)
+{
+    static char buf[256];
     size_t length = off;
     if (length)
         strcpy(buf, changeCase(m_word, true, length));
@@ -497,7 +525,7 @@ char *Word::commonType(lext *Plext, int nmbr, unsigned int freq)
     {
         if (freq == Plext[ii].S.frequency)
         {
-            const char *t = LemmaTag(Plext[ii].Type);
+            const char *t = LemmaTag(Plext[ii].Type());
             if (buf[0])
             {
                 if (strcmp(buf, t))
@@ -559,6 +587,7 @@ int taggedWord::addBaseFormsDL(lext *Plext, int nmbr, // The dictionary's availa
     plext = Plext;
     int m;
     const char *baseTp = LemmaTag(Tp);
+    tindex iTp = tagregistry::dictType(Tp); // -1: no reading has this type
 
     unsigned int maxFreq = maxFrequency(Plext, nmbr, baseTp, m);
     if (m > 1)
@@ -590,9 +619,9 @@ int taggedWord::addBaseFormsDL(lext *Plext, int nmbr, // The dictionary's availa
             // In reality, only if "skal" has POS tag V_IMP the lemma
             // "skalle" is correct.
 
-            if(!strcmp(baseTp,LemmaTag(plext->Type))) // Word is in dictionary,
+            if(!strcmp(baseTp,LemmaTag(plext->Type()))) // Word is in dictionary,
 #else
-            if (!strcmp(Tp, (plext->Type))) // Word is in dictionary,
+            if (plext->iType == iTp) // Word is in dictionary,
 #endif
             // and type info matches.
             {
@@ -645,9 +674,9 @@ int taggedWord::addBaseFormsDL(lext *Plext, int nmbr, // The dictionary's availa
                 {
                 if(plext->S.frequency >= maxFreq)
 #if PFRQ || FREQ24
-                    addBaseFormD(plext->constructBaseform(m_word),LemmaTag(plext->Type),plext->S.frequency);
+                    addBaseFormD(plext->constructBaseform(m_word),LemmaTag(plext->Type()),plext->S.frequency);
 #else
-                    addBaseFormD(plext->constructBaseform(m_word),LemmaTag(plext->Type));
+                    addBaseFormD(plext->constructBaseform(m_word),LemmaTag(plext->Type()));
 #endif
                     // We choose not to count the dictionary lemmas if the constructed lemma already is counted on.
                     if(--nmbr)
@@ -663,24 +692,36 @@ int taggedWord::addBaseFormsDL(lext *Plext, int nmbr, // The dictionary's availa
 
 void Word::lookup(text *txt)
 {
-    bool conflict = false;
-    tcount Pos;
-    int Nmbr;
-    if (dictionary::findword(itsWord(), m_tag, Pos, Nmbr))
+    int unknownTypes = txt->newcntTypes;
+    int conflictingTypes = txt->aConflictTypes;
+    if (!warmcache::replay(this, txt))
     {
-        addBaseFormsDL(LEXT + Pos, Nmbr, conflict, txt->cntD, txt->cntL);
-        if (conflict)
+        bool conflict = false;
+        bool unknown = false;
+        int cntD = txt->cntD;
+        int cntL = txt->cntL;
+        lext *Plext;
+        int Nmbr;
+        if (dictionary::findword(itsWord(), m_tag, Plext, Nmbr))
         {
-            txt->aConflictTypes++;
-            txt->aConflict += itsCnt();
+            addBaseFormsDL(Plext, Nmbr, conflict, txt->cntD, txt->cntL);
+            if (conflict)
+            {
+                txt->aConflictTypes++;
+                txt->aConflict += itsCnt();
+            }
         }
+        else
+        {
+            unknown = true;
+            txt->newcntTypes++;
+            txt->newcnt += itsCnt();
+            txt->cntL += addBaseFormsL();
+        }
+        warmcache::observe(this, unknown, conflict, txt->cntD - cntD, txt->cntL - cntL);
     }
-    else
-    {
-        txt->newcntTypes++;
-        txt->newcnt += itsCnt();
-        txt->cntL += addBaseFormsL();
-    }
+    Unknown = txt->newcntTypes != unknownTypes;
+    Conflicting = txt->aConflictTypes != conflictingTypes;
     if (basefrm::hasW)
     {
         addFullForm();
@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #if defined PROGLEMMATISE
 #include "outputclass.h"
 #include "basefrmpntr.h"
+#include "arena.h"
 #include <stdio.h>
 #include <string.h>
 #include <string>
@@ -47,6 +48,8 @@ struct lext;
 
 class Word : public OutputClass
 {
+    friend class warmcache;
+
 public:
     static Word *Root;
     static int LineNumber; // The number of the line where the previous word was found. For line-wise output. 0 is initial value
@@ -72,6 +75,8 @@ protected:
                              then lowercasing is likely default.
                              Keep uppercase if also found in non-segment initial position
                              */
+    bool Unknown : 1;     // lookup counted the type in text::newcntTypes
+    bool Conflicting : 1; // lookup counted the type in text::aConflictTypes
     void i() const
     {
         if (pbfL)
@@ -180,6 +185,8 @@ protected:
     static bool hasb;
     static bool hasB;
     char *commonStem(lext *Plext, int nmbr, const char *type, unsigned int freq, unsigned int &offset);
+    // The first off bytes of the word, lowercased, followed by suffix
+    char *stem(unsigned int off, const char *suffix);
     // Find the common type of the most frequent readings
     char *commonType(lext *Plext, int nmbr, unsigned int freq);
 
@@ -258,11 +265,12 @@ public:
             print();
         }
     }
+    static void *operator new(size_t size) { return arena::current->alloc(size); }
+    static void operator delete(void *) {}
     Word(const char *word)
-        : hasAddedItselfToBaseForm(false), FoundInDict(false), owns(true), SegmentInitial(true), pbfD(NULL), pbfL(NULL), cnt(1), m_tag(NULL)
+        : hasAddedItselfToBaseForm(false), FoundInDict(false), owns(true), SegmentInitial(true), Unknown(false), Conflicting(false), pbfD(NULL), pbfL(NULL), cnt(1), m_tag(NULL)
     {
-        this->m_word = new char[strlen(word) + 1];
-        strcpy(this->m_word, word);
+        this->m_word = arena::current->copy(word);
         ++reducedtotal;
     }
     Word(const Word &w)
@@ -270,6 +278,8 @@ public:
           FoundInDict(w.FoundInDict),
           owns(false),
           SegmentInitial(w.SegmentInitial),
+          Unknown(w.Unknown),
+          Conflicting(w.Conflicting),
           m_word(w.m_word),
           m_tag(NULL),
           pbfD(w.pbfD),
@@ -287,10 +297,7 @@ public:
     virtual ~Word()
     {
         if (owns)
-        {
-            delete m_word;
             deleteSecondaryStuff();
-        }
     }
 #if PRINTRULE
 #if PFRQ || FREQ24
@@ -379,6 +386,8 @@ public:
     void setSegmentInitial() { SegmentInitial = true; }
     void unsetSegmentInitial() { SegmentInitial = false; }
     bool segmentInitial() const { return SegmentInitial; }
+    bool unknown() const { return Unknown; }
+    bool conflicting() const { return Conflicting; }
 };
 
 class taggedWord : public Word
@@ -465,18 +474,12 @@ public:
     }
     taggedWord(const char *word, const char *tag) : Word(word)
     {
-        this->m_tag = new char[strlen(tag) + 1];
-        strcpy(this->m_tag, tag);
+        this->m_tag = arena::current->copy(tag);
     }
     taggedWord(taggedWord &w) : Word(w) // (Word & w) ==> (taggedWord & w)
     {
         m_tag = w.m_tag;
     }
-    virtual ~taggedWord()
-    {
-        if (owns)
-            delete m_tag;
-    }
     virtual int addBaseFormsL();
     virtual int addBaseFormsDL(lext *Plext, int nmbr,                 // The dictionary's available
                                                                       // lexical information for this word.
@@ -355,6 +355,8 @@ int wordReader::Put(bool (wordReader::*fnc)(int kar),int kar)
 
 const char * wordReader::convert(const char * s,char * buf,const char * lastBufByte)
     {
+    if(!strchr(s,'&'))
+        return s; // nothing to convert
     if(buf+strlen(s) < lastBufByte)
         {
         char * q = buf;
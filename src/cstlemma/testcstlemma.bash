@@ -0,0 +1,162 @@
+#!/bin/bash
+# Checks and timings for the dictionary and the lemmatiser.
+#
+# usage: testcstlemma.bash <cstlemma> <flex patterns> <lexicon> <text> [<option>...]
+#
+#   <lexicon>  full form dictionary, one <base form> TAB <full form> TAB <tag>
+#              per line (-cBFT)
+#   <text>     flat text to lemmatise. The bigger it is, the better the timings.
+#   <option>   passed on to every call, e.g. -eU for UTF-8 input.
+#
+# Each check prints "ok" or "FAILED", each timing the seconds it took.
+# The exit status is the number of failed checks.
+
+if [ $# -lt 4 ]; then
+    echo "usage: $0 <cstlemma> <flex patterns> <lexicon> <text> [<option>...]"
+    exit 1
+fi
+
+CSTLEMMA=$1
+RULES=$2
+LEXICON=$3
+TEXT=$4
+shift 4
+OPTIONS=("$@")
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+FAILED=0
+
+# result <what> <status>: report a check, which passed if the status is 0
+result()
+{
+    if [ "$2" -eq 0 ]; then
+        printf "ok      %s\n" "$1"
+    else
+        printf "FAILED  %s\n" "$1"
+        FAILED=$((FAILED+1))
+    fi
+}
+
+# same <what> <file> <file>: the files must be the same
+same()
+{
+    cmp -s "$2" "$3"
+    result "$1" $?
+}
+
+# timed <what> <command>...: run the command and print its wall time
+timed()
+{
+    WHAT=$1
+    shift
+    T=$( { TIMEFORMAT=%R; time "$@" > /dev/null 2>&1; } 2>&1 )
+    printf "%7ss %s\n" "$T" "$WHAT"
+}
+
+# lemmatise <input> <output> <option>...: the messages go to <output>.log
+lemmatise()
+{
+    IN=$1
+    OUT=$2
+    shift 2
+    "$CSTLEMMA" -L "${OPTIONS[@]}" -f "$RULES" -i "$IN" -o "$OUT" "$@" > "$OUT.log" 2>&1
+}
+
+# statistics <output>: the word and type counts in <output>.log
+statistics()
+{
+    grep -E '^(all|unknown|conflicting) ' "$1.log"
+}
+
+# Dictionary
+
+timed "make dictionary" "$CSTLEMMA" -D "${OPTIONS[@]}" -cBFT -i "$LEXICON" -o "$TMP/dict"
+
+# Each full form of the lexicon must get its base form from the dictionary.
+cut -f2 "$LEXICON" | grep -v ' ' > "$TMP/forms"
+timed "look up the lexicon's full forms" lemmatise "$TMP/forms" "$TMP/forms.out" -d "$TMP/dict" '-c$w\t$b\n' '-b$w' '-s|'
+awk -F'\t' 'NR == FNR { base[$1] = "|" $2 "|"; next }
+            $2 !~ / / && index(base[$2], "|" $1 "|") == 0 { missing++ }
+            END { exit missing > 0 }' "$TMP/forms.out" "$LEXICON"
+result "look up the lexicon's full forms" $?
+
+timed "lemmatise the text" lemmatise "$TEXT" "$TMP/text.out" -d "$TMP/dict"
+
+# format <name> <option>...: a dictionary made with the options must give the
+# same look-ups and lemmas as the one above
+format()
+{
+    NAME=$1
+    shift
+    timed "make dictionary, $NAME" "$CSTLEMMA" -D "${OPTIONS[@]}" -cBFT -i "$LEXICON" -o "$TMP/dict$NAME" "$@"
+    timed "look up the lexicon's full forms, $NAME" lemmatise "$TMP/forms" "$TMP/forms$NAME.out" -d "$TMP/dict$NAME" '-c$w\t$b\n' '-b$w' '-s|'
+    same "look up the lexicon's full forms, $NAME" "$TMP/forms.out" "$TMP/forms$NAME.out"
+    timed "lemmatise the text, $NAME" lemmatise "$TEXT" "$TMP/text$NAME.out" -d "$TMP/dict$NAME"
+    same "lemmatise the text, $NAME" "$TMP/text.out" "$TMP/text$NAME.out"
+}
+
+format -G2 -G2
+format -G2t -G2t
+format -G2P -G2 -P0.01
+format -G2f -G2f
+
+# A Bloom filter that is made when the dictionary is loaded (-P) must not
+# change the output either.
+timed "lemmatise the text, -P0.01" lemmatise "$TEXT" "$TMP/bloom.out" -d "$TMP/dict" -P0.01
+same "lemmatise the text, -P0.01" "$TMP/text.out" "$TMP/bloom.out"
+
+# Warm cache
+
+# Writing a warm cache (-M) and using it (-K) must not change the output or
+# the statistics.
+WARM=('-c$w\t$b\t$B\t$i\t$f\n' '-b$w' '-B$w')
+timed "lemmatise the text, cold" lemmatise "$TEXT" "$TMP/cold.out" -d "$TMP/dict" "${WARM[@]}"
+timed "lemmatise the text, -M" lemmatise "$TEXT" "$TMP/warmM.out" -d "$TMP/dict" "${WARM[@]}" -M"$TMP/warm"
+same "lemmatise the text, -M" "$TMP/cold.out" "$TMP/warmM.out"
+timed "lemmatise the text, -K" lemmatise "$TEXT" "$TMP/warmK.out" -d "$TMP/dict" "${WARM[@]}" -K"$TMP/warm"
+same "lemmatise the text, -K" "$TMP/cold.out" "$TMP/warmK.out"
+same "statistics, -K" <(statistics "$TMP/cold.out") <(statistics "$TMP/warmK.out")
+
+# Model bundle
+
+# A bundle (-Z) of the flex patterns and the -G2 dictionary must lemmatise
+# like the two files.
+timed "make bundle" "$CSTLEMMA" -Z "${OPTIONS[@]}" -f "$RULES" -d "$TMP/dict-G2" -o "$TMP/bundle"
+timed "lemmatise the text, bundle" "$CSTLEMMA" -L "${OPTIONS[@]}" -f "$TMP/bundle" -i "$TEXT" -o "$TMP/bundle.out"
+same "lemmatise the text, bundle" "$TMP/text.out" "$TMP/bundle.out"
+
+# Chunks
+
+# Lemmatising in chunks (-S) must give the same output and word counts as
+# lemmatising the text in one go. -S must refuse $f, which needs the
+# frequencies in the whole text.
+timed "lemmatise the text, -S1000" lemmatise "$TEXT" "$TMP/chunks.out" -d "$TMP/dict" -S1000
+same "lemmatise the text, -S1000" "$TMP/text.out" "$TMP/chunks.out"
+same "statistics, -S1000" <(statistics "$TMP/text.out") <(statistics "$TMP/chunks.out")
+lemmatise "$TEXT" "$TMP/chunksf.out" -d "$TMP/dict" -S1000 '-c$w\t$f\n'
+result "-S1000 refuses \$f" $((! $?))
+
+# Processes
+
+# Lemmatising parts of the text in several processes (-j) must give the same
+# output and word counts as one process. With $f, one process is used.
+for j in 2 4
+do
+    timed "lemmatise the text, -j$j" lemmatise "$TEXT" "$TMP/jobs$j.out" -d "$TMP/dict" -j$j
+    same "lemmatise the text, -j$j" "$TMP/text.out" "$TMP/jobs$j.out"
+    same "statistics, -j$j" <(statistics "$TMP/text.out") <(statistics "$TMP/jobs$j.out")
+done
+lemmatise "$TEXT" "$TMP/freq.out" -d "$TMP/dict" '-c$w\t$f\n'
+lemmatise "$TEXT" "$TMP/freqj.out" -d "$TMP/dict" '-c$w\t$f\n' -j4
+same "lemmatise the text with \$f, -j4" "$TMP/freq.out" "$TMP/freqj.out"
+
+# Sorting
+
+# Sorting the output (-qw#) in several threads (-J) must give the same output
+# as sorting in one thread.
+timed "sort the text" lemmatise "$TEXT" "$TMP/sorted.out" -d "$TMP/dict" -qw#
+timed "sort the text, -J4" lemmatise "$TEXT" "$TMP/sortedJ.out" -d "$TMP/dict" -qw# -J4
+same "sort the text, -J4" "$TMP/sorted.out" "$TMP/sortedJ.out"
+
+exit $FAILED
@@ -1,27 +1,47 @@
 import cLemmatiser
 
 class CstLemmatiser:
-    def __init__(self, flex_file, dict_file):
+    def __init__(self, flex_file, dict_file=None, background=False, warm_cache=None, delta_file=None, keep=0):
         self.flex_file = flex_file
         self.dict_file = dict_file
+        self.background = background
+        self.warm_cache = warm_cache
+        self.delta_file = delta_file
+        self.keep = keep
         self.construct()
     
     def construct(self):
-        self.lemmatiser_capsule = cLemmatiser.construct(self.flex_file, self.dict_file)
+        self.lemmatiser_capsule = cLemmatiser.construct(self.flex_file, self.dict_file, self.background, self.warm_cache, self.delta_file, self.keep)
 
-    def lemmatise_string(self, string):
-        return cLemmatiser.lemmatiseString(self.lemmatiser_capsule, string)
+    def lemmatise_string(self, string, with_status=False):
+        return cLemmatiser.lemmatiseString(self.lemmatiser_capsule, string, with_status)
 
-    def lemmatise_strings(self, strings):
-        return cLemmatiser.lemmatiseStrings(self.lemmatiser_capsule, strings)
+    def lemmatise_strings(self, strings, with_status=False):
+        return cLemmatiser.lemmatiseStrings(self.lemmatiser_capsule, strings, with_status)
+
+    def wait_until_ready(self):
+        return cLemmatiser.waitUntilReady(self.lemmatiser_capsule)
+
+    def dictionary_ready(self):
+        return cLemmatiser.dictionaryReady(self.lemmatiser_capsule)
+
+    def record_traffic(self, n_types=50000):
+        cLemmatiser.recordTraffic(self.lemmatiser_capsule, n_types)
+
+    def save_warm_cache(self, filename, n_types=50000):
+        return cLemmatiser.saveWarmCache(self.lemmatiser_capsule, filename, n_types)
 
     def __delete__(self):
         cLemmatiser.delete_object(self.lemmatiser_capsule)
 
     def __getstate__(self):
-        return [self.flex_file, self.dict_file]
+        return [self.flex_file, self.dict_file, self.background, self.warm_cache, self.delta_file, self.keep]
 
     def __setstate__(self, state):
-        self.flex_file, self.dict_file = state
+        self.flex_file, self.dict_file = state[:2]
+        self.background = state[2] if len(state) > 2 else False
+        self.warm_cache = state[3] if len(state) > 3 else None
+        self.delta_file = state[4] if len(state) > 4 else None
+        self.keep = state[5] if len(state) > 5 else 0
         self.construct()
         return
\ No newline at end of file